@@ -0,0 +1,97 @@
+/* gentab.c
+ * Lab6: Hash Tables
+ *
+ * Writes the C source for the random tables of jsw_hash, tab_hash, and
+ * twt_hash, and the CRC32C byte table of crc_hash, to stdout.  The makefile
+ * runs it to make hashes_tab.c, so the tables are constant data in the
+ * program instead of being filled on the first hash.  They no longer take
+ * numbers from drand48 and random, so the keys a driver makes for a given
+ * -s seed do not depend on the hash.
+ *
+ * Usage: gentab [seed]
+ *
+ * The numbers come from splitmix64 started at seed, so a seed always gives
+ * the same tables.  The makefile passes TAB_SEED.  The crc_hash table does
+ * not depend on the seed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "table.h"
+#include "hashes.h"
+#include "hashes_inline.h"
+
+static unsigned long long State;
+
+/* next splitmix64 number */
+static unsigned long long next(void)
+{
+    unsigned long long z = (State += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Print n numbers as the rows of an initializer, four to a line */
+static void print_row(int n, int wide)
+{
+    for (int j = 0; j < n; j++) {
+        if (j % 4 == 0) {
+            printf("    ");
+        }
+        if (wide) {
+            printf("0x%016llxULL,", next());
+        } else {
+            printf("0x%08xu,", (unsigned) (next() >> 32));
+        }
+        printf(j % 4 == 3 ? "\n" : " ");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    State = argc > 1 ? strtoull(argv[1], NULL, 0) : 0;
+
+    printf("/* hashes_tab.c\n");
+    printf(" * Generated by gentab with seed %s.  Do not edit, change TAB_SEED in the\n",
+            argc > 1 ? argv[1] : "0");
+    printf(" * makefile instead.\n");
+    printf(" */\n\n");
+    printf("#include \"table.h\"\n");
+    printf("#include \"hashes.h\"\n");
+    printf("#include \"hashes_inline.h\"\n\n");
+
+    printf("const unsigned int jsw_Tab[jsw_TABLESIZE] = {\n");
+    print_row(jsw_TABLESIZE, 0);
+    printf("};\n\n");
+
+    printf("const unsigned int tab_Tab[tab_MAXCHARS][tab_TABLESIZE] = {\n");
+    for (int i = 0; i < tab_MAXCHARS; i++) {
+        printf("  {\n");
+        print_row(tab_TABLESIZE, 0);
+        printf("  },\n");
+    }
+    printf("};\n\n");
+
+    printf("const unsigned long long twt_Tab[tab_MAXCHARS][tab_TABLESIZE] = {\n");
+    for (int i = 0; i < tab_MAXCHARS; i++) {
+        printf("  {\n");
+        print_row(tab_TABLESIZE, 1);
+        printf("  },\n");
+    }
+    printf("};\n\n");
+
+    //CRC32C byte table for the reflected polynomial
+    printf("const unsigned int crc_Tab[crc_TABLESIZE] = {\n");
+    for (unsigned i = 0; i < crc_TABLESIZE; i++) {
+        unsigned c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ crc_POLY : c >> 1;
+        }
+        printf(i % 4 == 0 ? "    0x%08xu," : " 0x%08xu,", c);
+        printf(i % 4 == 3 ? "\n" : "");
+    }
+    printf("};\n");
+    return 0;
+}
@@ -12,10 +12,13 @@
  * ECE 2230 changes:
  *     Changed all functions to assume that hashkey_t is a 32 bit integer.
  *     Beaware that this will fail with a different type of key.
- *     Changed jen_hash to ignore initval
+ *     Changed jen_hash to ignore initval, jen_hash_seed takes it for CUCKOO
  *
  *     jsw_hash is broken.  Hacked to create static table of random numbers.
- *     tab_hash is based on Tabulation Hash 
+ *     tab_hash is based on Tabulation Hash, twt_hash on twisted tabulation.
+ *     Their tables are generated at build time, see gentab.c
+ *     mur_hash, mxs_hash, and crc_hash mix the whole key at once instead of
+ *     one byte at a time
  *
  * All but elf_hash work great with random keys.  Perhaps elf would
  * be better with longer strings?
@@ -38,6 +41,10 @@
  *      jen_hash
  *      jsw_hash
  *      tab_hash
+ *      twt_hash
+ *      mur_hash
+ *      mxs_hash
+ *      crc_hash
  *
  * This works poorly for -i seq and -i rand because keys are too short?
  *      elf_hash
@@ -52,444 +59,276 @@
 #include <assert.h>
 #include "table.h"
 #include "hashes.h"
+#include "hashes_inline.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 static int HashAlgorithm = ABS_HASH;
+int HashReduction = REDUCE_MOD;
 
-unsigned djb_hash(hashkey_t key);
-unsigned djb_hash_xor(hashkey_t key);
-unsigned sax_hash(hashkey_t key);
-unsigned fnv_hash(hashkey_t key);
-unsigned oat_hash(hashkey_t key);
-unsigned jsw_hash(hashkey_t key);
-unsigned elf_hash(hashkey_t key);
-unsigned jen_hash(hashkey_t key);
-unsigned tab_hash(hashkey_t key);
+/* the random tables for jsw_hash, tab_hash, and twt_hash, and the byte
+ * table for crc_hash, are in hashes_tab.c, which the makefile generates
+ * with gentab
+ */
+int crc_Hardware = 0;   /* the CPU has the SSE4.2 crc32 instruction */
+
+/* Magic number for hashes_reduce, computed once per table size.  Sizes must
+ * be positive.  The magic for size 1 is 0, which falls back to the mod.
+ */
+unsigned long long hashes_mod_magic(int size)
+{
+    assert(size > 0);
+    return ~0ULL / (unsigned) size + 1;
+}
 
 /* A wrapper function to call the various hashing algorims.  The
  * abs_hash is used by defult unless changed with hashes_configure
  *
- * Pick a hash funcion X_hash() from the hashes.c file.  All hash functions
- * return an unsigned int.  Then mod with table size.  Return signed result.  
+ * Pick a hash funcion X_hash() from hashes_inline.h.  All hash functions
+ * return an unsigned int.  Then reduce to the table size.  Return signed result.  
  */
 int hashes_table_pos(hashkey_t key, int tablesize)
 {
-    switch (HashAlgorithm) {
-        case ABS_HASH: return abs(key) % tablesize;
-        case DJB_HASH: return djb_hash(key) % tablesize;
-        case SAX_HASH: return sax_hash(key) % tablesize;
-        case FNV_HASH: return fnv_hash(key) % tablesize;
-        case OAT_HASH: return oat_hash(key) % tablesize;
-        case JEN_HASH: return jen_hash(key) % tablesize;
-        case JSW_HASH: return jsw_hash(key) % tablesize;
-        case ELF_HASH: return elf_hash(key) % tablesize;
-        case TAB_HASH: return tab_hash(key) % tablesize;
-        default:
-                       printf("\n\tInvalid Hash algorithm: %d\n", HashAlgorithm);
-                       printf("\t run ./lab6 -f help to see hash function options\n");
-    }
-    exit(1);
+    return hashes_reduce(hashes_hash_alg(HashAlgorithm, key), tablesize, 0);
+}
+
+/* Same as hashes_table_pos, with the magic number for tablesize */
+int hashes_table_pos_magic(hashkey_t key, int tablesize, unsigned long long magic)
+{
+    return hashes_reduce(hashes_hash_alg(HashAlgorithm, key), tablesize, magic);
 }
 
 /* Function to calculate the probe decrement for double hashing only.  You
  * can assume this function is only called when the probe type is double.
  *
- * Pick a different hash function X_hash() than used in table_hash.  After taking
- * the mod to get a decrement value, make sure the decrement is at least 1.
- *
- * I selected this hash algorithm for no good reason.  Future work is to
- * consider other functions.  But need to make sure that double hashing 
- * uses two different hashing algorithms.
+ * The decrement comes from the same hash value as the home position, see
+ * hashes_dec_inline, so a double hashed search hashes its key once.  It
+ * used to be a second hash function (djb_hash_xor) of the key, which was
+ * twice the work and, with -f djb, barely different from the home hash.
+ * The decrement is scaled into [1, size-1], so every decrement is equally
+ * likely and none has to be bumped up from 0.
  */
 int hashes_probe_dec(hashkey_t key, int size)
 {
-    int prob_dec = djb_hash_xor(key) % size;
-    if (prob_dec < 1) prob_dec = 1;
-    return prob_dec;
+    return hashes_dec_inline(hashes_hash_alg(HashAlgorithm, key), size);
 }
 
-void hashes_configure(int alg)
+/* Select how hash values are reduced to table positions, REDUCE_MOD (the
+ * default) or REDUCE_FAST.  Applies to every table.
+ */
+void hashes_reduction(int mode)
 {
-    HashAlgorithm = alg;
-    switch (alg) {
-        case ABS_HASH: printf("Using hash algorithm abs_hash\n"); break;
-        case DJB_HASH: printf("Using hash algorithm djb_hash\n"); break;
-        case SAX_HASH: printf("Using hash algorithm sax_hash\n"); break;
-        case FNV_HASH: printf("Using hash algorithm fnv_hash\n"); break;
-        case OAT_HASH: printf("Using hash algorithm oat_hash\n"); break;
-        case JEN_HASH: printf("Using hash algorithm jen_hash\n"); break;
-        case JSW_HASH: printf("Using hash algorithm jsw_hash\n"); break;
-        case ELF_HASH: printf("Using hash algorithm elf_hash\n"); break;
-        case TAB_HASH: printf("Using hash algorithm tab_hash\n"); break;
+    HashReduction = mode;
+    switch (mode) {
+        case REDUCE_MOD: break;
+        case REDUCE_FAST: printf("Using multiply-shift position reduction\n"); break;
         default:
-                       printf("\n\tInvalid Hash algorithm: %d\n", HashAlgorithm);
-                       printf("\t run ./lab6 -f help to see hash function options\n");
+                       printf("\n\tInvalid reduction: %d\n", mode);
                        exit(1);
     }
 }
 
-/* #### Bernstein
- 
-Dan Bernstein created this algorithm and posted it in a newsgroup. It is
-known by many as the Chris Torek hash because Chris went a long way
-toward popularizing it. Since then it has been used successfully by
-many, but despite that the algorithm itself is not very sound when it
-comes to avalanche and permutation of the internal state. It has proven
-very good for small character keys, where it can outperform algorithms
-that result in a more random distribution:
+/* Batch hashing.  With AVX2 the hash of 8 keys is computed at once, one key
+ * per 32-bit lane, using the same steps as the scalar function so the
+ * values are identical.  The byte loops become shifts of the whole key,
+ * and tab_hash and jsw_hash look up their tables with gathers.  AVX2 has
+ * no 64-bit multiply, so mxs_hash stays scalar, as does crc_hash, which is
+ * already one instruction, and twt_hash, whose last lookup waits on the
+ * first three.  The CPU is checked at startup, so the kernels
+ * are built with a target attribute and the rest of the file does not need
+ * -mavx2.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+static int HashAvx2 = 0;
+#endif
 
-Bernstein's hash should be used with caution. It performs very well in
-practice, for no apparently known reasons (much like how the constant 33
-does better than more logical constants for no apparent reason), but in
-theory it is not up to snuff. Always test this function with sample data
-for every application to ensure that it does not encounter a degenerate
-case and cause excessive collisions.
-*/
-unsigned djb_hash(hashkey_t key)
+/* Check the CPU once, before main, so the hash functions read crc_Hardware
+ * and HashAvx2 without a first-use check and threads never write them.
+ */
+__attribute__((constructor))
+static void hashes_check_cpu(void)
 {
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 0;
-    int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h = 33 * h + p[i];
-    }
-    return h;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    crc_Hardware = __builtin_cpu_supports("sse4.2") != 0;
+    HashAvx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
 }
 
-/* #### Modified Bernstein
+#if defined(__x86_64__) || defined(__i386__)
 
-A minor update to Bernstein's hash replaces addition with XOR for the
-combining step. This change does not appear to be well known or often
-used, the original algorithm is still recommended by nearly everyone,
-but the new algorithm typically results in a better distribution:
+#define V8(x)       _mm256_set1_epi32((int) (x))
+#define BYTE8(k, i) _mm256_and_si256(_mm256_srli_epi32((k), 8 * (i)), V8(0xff))
 
-*/
-unsigned djb_hash_xor(hashkey_t key)
+__attribute__((target("avx2")))
+static __m256i hash8_avx2(int alg, __m256i k)
 {
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 0;
+    __m256i h, g, a, b, c;
     int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h = 33 * h ^ p[i];
+    switch (alg) {
+        case ABS_HASH:
+            return _mm256_abs_epi32(k);
+        case DJB_HASH:
+            h = _mm256_setzero_si256();
+            for (i = 0; i < 4; i++) {
+                h = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(h, 5), h), BYTE8(k, i));
+            }
+            return h;
+        case SAX_HASH:
+            h = _mm256_setzero_si256();
+            for (i = 0; i < 4; i++) {
+                h = _mm256_xor_si256(h, _mm256_add_epi32(_mm256_add_epi32(
+                            _mm256_slli_epi32(h, 5), _mm256_srli_epi32(h, 2)), BYTE8(k, i)));
+            }
+            return h;
+        case FNV_HASH:
+            h = V8(2166136261u);
+            for (i = 0; i < 4; i++) {
+                h = _mm256_xor_si256(_mm256_mullo_epi32(h, V8(16777619)), BYTE8(k, i));
+            }
+            return h;
+        case OAT_HASH:
+            h = _mm256_setzero_si256();
+            for (i = 0; i < 4; i++) {
+                h = _mm256_add_epi32(h, BYTE8(k, i));
+                h = _mm256_add_epi32(h, _mm256_slli_epi32(h, 10));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 6));
+            }
+            h = _mm256_add_epi32(h, _mm256_slli_epi32(h, 3));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 11));
+            return _mm256_add_epi32(h, _mm256_slli_epi32(h, 15));
+        case JEN_HASH:
+            //one jen_mix of the key, see jen_hash_seed with initval 0
+            a = _mm256_add_epi32(V8(0x9e3779b9u), k);
+            b = V8(0x9e3779b9u);
+            c = V8(sizeof(hashkey_t));
+#define SUB3(x, y, z) x = _mm256_sub_epi32(_mm256_sub_epi32(x, y), z)
+            SUB3(a, b, c); a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 13));
+            SUB3(b, c, a); b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 8));
+            SUB3(c, a, b); c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 13));
+            SUB3(a, b, c); a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 12));
+            SUB3(b, c, a); b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 16));
+            SUB3(c, a, b); c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 5));
+            SUB3(a, b, c); a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 3));
+            SUB3(b, c, a); b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 10));
+            SUB3(c, a, b); c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 15));
+#undef SUB3
+            return c;
+        case JSW_HASH:
+            h = V8(16777551);
+            for (i = 0; i < 4; i++) {
+                h = _mm256_or_si256(_mm256_slli_epi32(h, 1), _mm256_srli_epi32(h, 31));
+                h = _mm256_xor_si256(h, _mm256_i32gather_epi32((const int *) jsw_Tab,
+                            BYTE8(k, i), 4));
+            }
+            return h;
+        case ELF_HASH:
+            h = _mm256_setzero_si256();
+            for (i = 0; i < 4; i++) {
+                h = _mm256_add_epi32(_mm256_slli_epi32(h, 4), BYTE8(k, i));
+                g = _mm256_and_si256(h, V8(0xf0000000u));
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(g, 24));
+                h = _mm256_andnot_si256(g, h);
+            }
+            return h;
+        case TAB_HASH:
+            h = _mm256_setzero_si256();
+            for (i = 0; i < 4; i++) {
+                h = _mm256_xor_si256(h, _mm256_i32gather_epi32((const int *) tab_Tab[i],
+                            BYTE8(k, i), 4));
+            }
+            return h;
+        case MUR_HASH:
+            h = _mm256_xor_si256(k, _mm256_srli_epi32(k, 16));
+            h = _mm256_mullo_epi32(h, V8(0x85ebca6bu));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+            h = _mm256_mullo_epi32(h, V8(0xc2b2ae35u));
+            return _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
     }
-
-    return h;
+    assert(0);
+    return k;
 }
 
-/* #### Shift-Add-XOR hash
-
-The shift-add-XOR hash was designed as a string hashing function, but
-because it is so effective, it works for any data as well with similar
-efficiency. The algorithm is surprisingly similar to the rotating hash
-except a different choice of constants for the rotation is used, and
-addition is a preferred operation for mixing. All in all, this is a
-surprisingly powerful and flexible hash. Like many effective hashes, it
-will fail tests for avalanche, but that does not seem to affect its
-performance in practice.
-*/
-unsigned sax_hash(hashkey_t key)
+/* Hash keys 8 at a time while at least 8 are left.  Returns how many were
+ * done, 0 if alg has no kernel.
+ */
+__attribute__((target("avx2")))
+static int hash_batch_avx2(int alg, const hashkey_t *keys, int n, unsigned *out)
 {
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 0;
-    int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h ^= (h << 5) + (h >> 2) + p[i];
+    if (alg == MXS_HASH || alg == CRC_HASH || alg == TWT_HASH) {
+        return 0;
     }
-
-    return h;
-}
-
-/* #### FNV hash
-
-The FNV hash, short for Fowler/Noll/Vo in honor of the creators, is a
-very powerful algorithm that, not surprisingly, follows the same lines
-as Bernstein's modified hash with carefully chosen constants. This
-algorithm has been used in many applications with wonderful results, and
-for its simplicity, the FNV hash should be one of the first hashes tried
-in an application. It is also recommended that the [FNV website]
-(http://www.isthe.com/chongo/tech/comp/fnv/) be visited for
-useful descriptions of how to modify the algorithm for various uses.
-*/
-unsigned fnv_hash(hashkey_t key)
-{
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 2166136261;
     int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h = (h * 16777619) ^ p[i];
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i k = _mm256_loadu_si256((const __m256i *) (keys + i));
+        _mm256_storeu_si256((__m256i *) (out + i), hash8_avx2(alg, k));
     }
-
-    return h;
-}
-
-/* #### One-at-a-Time hash
-
-Bob Jenkins is a well known authority on designing hash functions for
-table lookup. In fact, one of his hashes is considered state of the art
-for lookup, which we will see shortly. A considerably simpler algorithm
-of his design is the One-at-a-Time hash:
-
-This algorithm quickly reaches avalanche and performs very well. This
-function is another that should be one of the first to be tested in any
-application, if not the very first. This algorithm is my personal
-preference as a first test hash, and it has seen effective use in
-several high level scripting languages as the hash function for their
-associative array data type.
-*/
-unsigned oat_hash(hashkey_t key)
-{
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 0;
-    int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h += p[i];
-        h += (h << 10);
-        h ^= (h >> 6);
-    }
-
-    h += (h << 3);
-    h ^= (h >> 11);
-    h += (h << 15);
-
-    return h;
+    return i;
 }
+#endif
 
-/* #### JSW hash
-
-This is a hash of my own devising that combines a rotating hash with a
-table of randomly generated numbers. The algorithm walks through each
-byte of the input, and uses it as an index into a table of random
-integers generated by a good random number generator. The internal state
-is rotated to mix it up a bit, then XORed with the random number from
-the table. The result is a uniform distribution if the random numbers
-are uniform. The size of the table should match the values in a byte.
-For example, if a byte is eight bits then the table would hold 256
-random numbers:
-
-In general, this algorithm is among the better ones that I have tested
-in terms of both distribution and performance. I may be slightly biased,
-but I feel that this function should be on the list of the first to test
-in a new application using hash lookup.
-*/
-
-// hbr: Make a table of 256 random numbers.  Slightly less than perfect because
-// does not consider sign bit.  Would prefer to malloc table, but then need
-// to figure out how to free it.
-//
-// Also, claims by JSW about performance not well supported, unlike tabulation
-// hashing.
-#define jsw_TABLESIZE 256
-static unsigned int jsw_Tab[jsw_TABLESIZE];
-static int jsw_InitTable = 0;
-void jsw_make_table(void)
+/* Hash n keys with algorithm alg, out[i] = hashes_hash_alg(alg, keys[i])
+ * Inputs: algorithm, array of n keys, array of n results
+ * Outputs: none
+ */
+void hashes_hash_batch(int alg, const hashkey_t *keys, int n, unsigned *out)
 {
-    for (int i = 0; i < jsw_TABLESIZE; i++) {
-        jsw_Tab[i] = (unsigned) (INT_MAX * drand48());
+    int i = 0;
+    if (n <= 0) {
+        return;
     }
-}
-
-unsigned jsw_hash(hashkey_t key)
-{
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 16777551;
-    int i;
-
-    // hbr hack to automatically make table on first call
-    if (jsw_InitTable == 0) {
-        jsw_InitTable = 1;
-        jsw_make_table();
+#if defined(__x86_64__) || defined(__i386__)
+    if (HashAvx2) {
+        i = hash_batch_avx2(alg, keys, n, out);
     }
-
-    for (i = 0; i < len; i++)
-    {
-        h = (h << 1 | h >> 31) ^ jsw_Tab[p[i]];
+#endif
+    for (; i < n; i++) {
+        out[i] = hashes_hash_alg(alg, keys[i]);
     }
-
-    return h;
 }
 
-
-/* #### ELF hash
-
-The ELF hash function has been around for a while, and it is believed to
-be one of the better algorithms out there. In my experience, this is
-true, though ELF hash does not perform sufficiently better than most of
-the other algorithms presented in this tutorial to justify its slightly
-more complicated implementation. It should be on your list of first
-functions to test in a new lookup implementation:
-
-*/
-unsigned elf_hash(hashkey_t key)
+/* hashes_table_pos for n keys at once
+ * Inputs: array of n keys, table size, array of n results
+ * Outputs: none
+ */
+void hashes_table_pos_batch(const hashkey_t *keys, int n, int tablesize, int *out)
 {
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    unsigned h = 0, g;
-    int i;
-
-    for (i = 0; i < len; i++)
-    {
-        h = (h << 4) + p[i];
-        g = h & 0xf0000000L;
-
-        if (g != 0)
-        {
-            h ^= g >> 24;
-        }
-
-        h &= ~g;
+    unsigned long long magic = hashes_mod_magic(tablesize);
+    hashes_hash_batch(HashAlgorithm, keys, n, (unsigned *) out);
+    for (int i = 0; i < n; i++) {
+        out[i] = hashes_reduce((unsigned) out[i], tablesize, magic);
     }
-
-    return h;
-}
-
-/* #### Jenkins hash
-
-The dreaded Jenkins hash has been thoroughly tested and passes all kinds
-of tests for avalanche and permutations. As such it is considered to be
-one of the best and most thoroughly analyzed algorithms on the market
-presently. Unfortunately, it is also ridiculously complicated compared
-to the other hashes examined in this tutorial:
-
-For details on how this algorithm works, feel free to visit Bob Jenkins'
-[website](http://burtleburtle.net/bob/).
-*/
-
-// if table size is a power of two, then mask result using hashmask instead of 
-// using % tablesize
-#define hashsize(n) (1U << (n))
-#define hashmask(n) (hashsize(n) - 1)
-
-#define mix(a,b,c) \
-{ \
-    a -= b; a -= c; a ^= (c >> 13); \
-    b -= c; b -= a; b ^= (a << 8); \
-    c -= a; c -= b; c ^= (b >> 13); \
-    a -= b; a -= c; a ^= (c >> 12); \
-    b -= c; b -= a; b ^= (a << 16); \
-    c -= a; c -= b; c ^= (b >> 5); \
-    a -= b; a -= c; a ^= (c >> 3); \
-    b -= c; b -= a; b ^= (a << 10); \
-    c -= a; c -= b; c ^= (b >> 15); \
 }
 
-// hbr original: unsigned jen_hash(unsigned char *k, unsigned length, unsigned initval)
-unsigned jen_hash(hashkey_t key)
-{
-    // hbr
-    unsigned length = sizeof(key);
-    // Bob's web site claims the idea for initval is to use the previous result 
-    // to seed the next calculation.
-    //
-    // I have just set to zero because this idea does not seem to work for our 
-    // application.  We need to be able to repeat the calulation for lookups!
-    // So, initval needs to have same value when used to recalculate the hash
-    // for a key.
-    //
-    // initval can be useful if need to change hash values, such as for cockoo
-    // hash when a rehash is required.
-    unsigned initval = 0;  
-    unsigned char *k = (unsigned char *) &key;
-
-    unsigned a, b;
-    unsigned c = initval;
-    unsigned len = length;
-
-    a = b = 0x9e3779b9;
-
-    while (len >= 12)
-    {
-        a += (k[0] + ((unsigned)k[1] << 8) + ((unsigned)k[2] << 16) + ((unsigned)k[3] << 24));
-        b += (k[4] + ((unsigned)k[5] << 8) + ((unsigned)k[6] << 16) + ((unsigned)k[7] << 24));
-        c += (k[8] + ((unsigned)k[9] << 8) + ((unsigned)k[10] << 16) + ((unsigned)k[11] << 24));
-
-        mix(a, b, c);
-
-        k += 12;
-        len -= 12;
-    }
-
-    c += length;
-
-    switch (len)
-    {
-    case 11: c += ((unsigned)k[10] << 24);
-    case 10: c += ((unsigned)k[9] << 16);
-    case 9: c += ((unsigned)k[8] << 8);
-        /* First byte of c reserved for length */
-    case 8: b += ((unsigned)k[7] << 24);
-    case 7: b += ((unsigned)k[6] << 16);
-    case 6: b += ((unsigned)k[5] << 8);
-    case 5: b += k[4];
-    case 4: a += ((unsigned)k[3] << 24);
-    case 3: a += ((unsigned)k[2] << 16);
-    case 2: a += ((unsigned)k[1] << 8);
-    case 1: a += k[0];
-    }
-
-    mix(a, b, c);
-
-    return c;
-}
-
-/* tabulation hashing.  https://en.wikipedia.org/wiki/Tabulation_hashing
- *
- * This is a universal hashing algorithm.  But not good enough to give 
- * bounded insertion time for cockoo hashing, in general.  
- *
- * Note this is limited to 4 characters (i.e., bytes).  This can be extended to longer
- * strings but the tables also grow large.  Handling long strings needs
- * a different approach.  
- *
- */
-#define tab_TABLESIZE 256
-#define tab_MAXCHARS  4
-static unsigned int tab_Tab[tab_MAXCHARS][tab_TABLESIZE];
-static int tab_InitTable = 0;
-/* use gcc lib random function.  It generates a long int in range 0 to RAND_MAX.
- *
- * RAND_MAX is the same as INT_MAX for gcc, so the result is 31 bits.
+/* The algorithm chosen with hashes_configure.  New tables use it unless they
+ * are constructed with their own, see table_construct_hash.
  */
-void tab_make_table(void)
+int hashes_algorithm(void)
 {
-    for (int i = 0; i < tab_MAXCHARS; i++) {
-        for (int j = 0; j < tab_TABLESIZE; j++) {
-            tab_Tab[i][j] = random();
-        }
-    }
+    return HashAlgorithm;
 }
 
-unsigned int tab_hash(hashkey_t key)
+void hashes_configure(int alg)
 {
-    int len = sizeof(key);
-    unsigned char *p = (unsigned char *) &key;
-    int i;
-    unsigned int h = 0;
-    assert(len <= tab_MAXCHARS);
-
-    // hack to automatically make table on first call
-    if (tab_InitTable == 0) {
-        tab_InitTable = 1;
-        tab_make_table();
-    }
-
-    for (i = 0; i < len; i++)
-    {
-        h ^= tab_Tab[i][p[i]];
+    HashAlgorithm = alg;
+    switch (alg) {
+        case ABS_HASH: printf("Using hash algorithm abs_hash\n"); break;
+        case DJB_HASH: printf("Using hash algorithm djb_hash\n"); break;
+        case SAX_HASH: printf("Using hash algorithm sax_hash\n"); break;
+        case FNV_HASH: printf("Using hash algorithm fnv_hash\n"); break;
+        case OAT_HASH: printf("Using hash algorithm oat_hash\n"); break;
+        case JEN_HASH: printf("Using hash algorithm jen_hash\n"); break;
+        case JSW_HASH: printf("Using hash algorithm jsw_hash\n"); break;
+        case ELF_HASH: printf("Using hash algorithm elf_hash\n"); break;
+        case TAB_HASH: printf("Using hash algorithm tab_hash\n"); break;
+        case MUR_HASH: printf("Using hash algorithm mur_hash\n"); break;
+        case MXS_HASH: printf("Using hash algorithm mxs_hash\n"); break;
+        case CRC_HASH: printf("Using hash algorithm crc_hash\n"); break;
+        case TWT_HASH: printf("Using hash algorithm twt_hash\n"); break;
+        default:
+                       printf("\n\tInvalid Hash algorithm: %d\n", HashAlgorithm);
+                       printf("\t run ./lab6 -f help to see hash function options\n");
+                       exit(1);
     }
-    return h;
 }
@@ -4,15 +4,24 @@
  *
  * Provided utility file for the project
  *
- * See notes is hashes.c for details
+ * See notes is hashes.c for details.  The hash functions themselves are in
+ * hashes_inline.h
  *
  * No changes are needed
  */
 
-enum Hash_Alg_t {ABS_HASH, DJB_HASH, SAX_HASH, FNV_HASH, OAT_HASH, JEN_HASH, JSW_HASH, ELF_HASH, TAB_HASH};
+enum Hash_Alg_t {ABS_HASH, DJB_HASH, SAX_HASH, FNV_HASH, OAT_HASH, JEN_HASH, JSW_HASH, ELF_HASH, TAB_HASH,
+                 MUR_HASH, MXS_HASH, CRC_HASH, TWT_HASH};
+enum Hash_Reduce_t {REDUCE_MOD, REDUCE_FAST};
 
 int hashes_table_pos(hashkey_t key, int tablesize);
 int hashes_probe_dec(hashkey_t key, int size);
+unsigned long long hashes_mod_magic(int size);
+int hashes_table_pos_magic(hashkey_t key, int tablesize, unsigned long long magic);
 void hashes_configure(int alg);
+int hashes_algorithm(void);
+void hashes_reduction(int mode);
+void hashes_hash_batch(int alg, const hashkey_t *keys, int n, unsigned *out);
+void hashes_table_pos_batch(const hashkey_t *keys, int n, int tablesize, int *out);
 
 
@@ -0,0 +1,526 @@
+/* hashes_inline.h
+ * Lab6: Hash Tables
+ *
+ * The hash functions behind hashes.c, as static inline functions so the
+ * table code can expand them inside its probe loops.  The random tables for
+ * jsw_hash, tab_hash, and twt_hash are made at build time by gentab, see the
+ * makefile, and are the same in every file that hashes a key.
+ *
+ * Include after table.h and hashes.h.  Only hashes.c and table.c need this.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <assert.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+/* #### Bernstein
+ 
+Dan Bernstein created this algorithm and posted it in a newsgroup. It is
+known by many as the Chris Torek hash because Chris went a long way
+toward popularizing it. Since then it has been used successfully by
+many, but despite that the algorithm itself is not very sound when it
+comes to avalanche and permutation of the internal state. It has proven
+very good for small character keys, where it can outperform algorithms
+that result in a more random distribution:
+
+Bernstein's hash should be used with caution. It performs very well in
+practice, for no apparently known reasons (much like how the constant 33
+does better than more logical constants for no apparent reason), but in
+theory it is not up to snuff. Always test this function with sample data
+for every application to ensure that it does not encounter a degenerate
+case and cause excessive collisions.
+*/
+static inline unsigned djb_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = 33 * h + p[i];
+    }
+    return h;
+}
+
+/* #### Modified Bernstein
+
+A minor update to Bernstein's hash replaces addition with XOR for the
+combining step. This change does not appear to be well known or often
+used, the original algorithm is still recommended by nearly everyone,
+but the new algorithm typically results in a better distribution:
+
+*/
+static inline unsigned djb_hash_xor(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = 33 * h ^ p[i];
+    }
+
+    return h;
+}
+
+/* #### Shift-Add-XOR hash
+
+The shift-add-XOR hash was designed as a string hashing function, but
+because it is so effective, it works for any data as well with similar
+efficiency. The algorithm is surprisingly similar to the rotating hash
+except a different choice of constants for the rotation is used, and
+addition is a preferred operation for mixing. All in all, this is a
+surprisingly powerful and flexible hash. Like many effective hashes, it
+will fail tests for avalanche, but that does not seem to affect its
+performance in practice.
+*/
+static inline unsigned sax_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h ^= (h << 5) + (h >> 2) + p[i];
+    }
+
+    return h;
+}
+
+/* #### FNV hash
+
+The FNV hash, short for Fowler/Noll/Vo in honor of the creators, is a
+very powerful algorithm that, not surprisingly, follows the same lines
+as Bernstein's modified hash with carefully chosen constants. This
+algorithm has been used in many applications with wonderful results, and
+for its simplicity, the FNV hash should be one of the first hashes tried
+in an application. It is also recommended that the [FNV website]
+(http://www.isthe.com/chongo/tech/comp/fnv/) be visited for
+useful descriptions of how to modify the algorithm for various uses.
+*/
+static inline unsigned fnv_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 2166136261;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = (h * 16777619) ^ p[i];
+    }
+
+    return h;
+}
+
+/* #### One-at-a-Time hash
+
+Bob Jenkins is a well known authority on designing hash functions for
+table lookup. In fact, one of his hashes is considered state of the art
+for lookup, which we will see shortly. A considerably simpler algorithm
+of his design is the One-at-a-Time hash:
+
+This algorithm quickly reaches avalanche and performs very well. This
+function is another that should be one of the first to be tested in any
+application, if not the very first. This algorithm is my personal
+preference as a first test hash, and it has seen effective use in
+several high level scripting languages as the hash function for their
+associative array data type.
+*/
+static inline unsigned oat_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h += p[i];
+        h += (h << 10);
+        h ^= (h >> 6);
+    }
+
+    h += (h << 3);
+    h ^= (h >> 11);
+    h += (h << 15);
+
+    return h;
+}
+
+/* #### JSW hash
+
+This is a hash of my own devising that combines a rotating hash with a
+table of randomly generated numbers. The algorithm walks through each
+byte of the input, and uses it as an index into a table of random
+integers generated by a good random number generator. The internal state
+is rotated to mix it up a bit, then XORed with the random number from
+the table. The result is a uniform distribution if the random numbers
+are uniform. The size of the table should match the values in a byte.
+For example, if a byte is eight bits then the table would hold 256
+random numbers:
+
+In general, this algorithm is among the better ones that I have tested
+in terms of both distribution and performance. I may be slightly biased,
+but I feel that this function should be on the list of the first to test
+in a new application using hash lookup.
+*/
+
+// hbr: Make a table of 256 random numbers.  Slightly less than perfect because
+// does not consider sign bit.  Would prefer to malloc table, but then need
+// to figure out how to free it.
+//
+// Also, claims by JSW about performance not well supported, unlike tabulation
+// hashing.
+#define jsw_TABLESIZE 256
+extern const unsigned int jsw_Tab[jsw_TABLESIZE];
+
+static inline unsigned jsw_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 16777551;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = (h << 1 | h >> 31) ^ jsw_Tab[p[i]];
+    }
+
+    return h;
+}
+
+
+/* #### ELF hash
+
+The ELF hash function has been around for a while, and it is believed to
+be one of the better algorithms out there. In my experience, this is
+true, though ELF hash does not perform sufficiently better than most of
+the other algorithms presented in this tutorial to justify its slightly
+more complicated implementation. It should be on your list of first
+functions to test in a new lookup implementation:
+
+*/
+static inline unsigned elf_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = 0, g;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        h = (h << 4) + p[i];
+        g = h & 0xf0000000L;
+
+        if (g != 0)
+        {
+            h ^= g >> 24;
+        }
+
+        h &= ~g;
+    }
+
+    return h;
+}
+
+/* #### Jenkins hash
+
+The dreaded Jenkins hash has been thoroughly tested and passes all kinds
+of tests for avalanche and permutations. As such it is considered to be
+one of the best and most thoroughly analyzed algorithms on the market
+presently. Unfortunately, it is also ridiculously complicated compared
+to the other hashes examined in this tutorial:
+
+For details on how this algorithm works, feel free to visit Bob Jenkins'
+[website](http://burtleburtle.net/bob/).
+*/
+
+// if table size is a power of two, then mask result using hashmask instead of 
+// using % tablesize
+#define hashsize(n) (1U << (n))
+#define hashmask(n) (hashsize(n) - 1)
+
+#define jen_mix(a,b,c) \
+{ \
+    a -= b; a -= c; a ^= (c >> 13); \
+    b -= c; b -= a; b ^= (a << 8); \
+    c -= a; c -= b; c ^= (b >> 13); \
+    a -= b; a -= c; a ^= (c >> 12); \
+    b -= c; b -= a; b ^= (a << 16); \
+    c -= a; c -= b; c ^= (b >> 5); \
+    a -= b; a -= c; a ^= (c >> 3); \
+    b -= c; b -= a; b ^= (a << 10); \
+    c -= a; c -= b; c ^= (b >> 15); \
+}
+
+// hbr original: unsigned jen_hash(unsigned char *k, unsigned length, unsigned initval)
+static inline unsigned jen_hash_seed(hashkey_t key, unsigned initval)
+{
+    // hbr
+    unsigned length = sizeof(key);
+    // Bob's web site claims the idea for initval is to use the previous result 
+    // to seed the next calculation.
+    //
+    // jen_hash just sets it to zero because this idea does not seem to work for our 
+    // application.  We need to be able to repeat the calulation for lookups!
+    // So, initval needs to have same value when used to recalculate the hash
+    // for a key.
+    //
+    // initval is useful when we need to change hash values, such as for cuckoo
+    // hash when a rehash is required.  CUCKOO tables use one initval per hash
+    // function and change them all when the table is reseeded.
+    unsigned char *k = (unsigned char *) &key;
+
+    unsigned a, b;
+    unsigned c = initval;
+    unsigned len = length;
+
+    a = b = 0x9e3779b9;
+
+    while (len >= 12)
+    {
+        a += (k[0] + ((unsigned)k[1] << 8) + ((unsigned)k[2] << 16) + ((unsigned)k[3] << 24));
+        b += (k[4] + ((unsigned)k[5] << 8) + ((unsigned)k[6] << 16) + ((unsigned)k[7] << 24));
+        c += (k[8] + ((unsigned)k[9] << 8) + ((unsigned)k[10] << 16) + ((unsigned)k[11] << 24));
+
+        jen_mix(a, b, c);
+
+        k += 12;
+        len -= 12;
+    }
+
+    c += length;
+
+    switch (len)
+    {
+    case 11: c += ((unsigned)k[10] << 24);
+    case 10: c += ((unsigned)k[9] << 16);
+    case 9: c += ((unsigned)k[8] << 8);
+        /* First byte of c reserved for length */
+    case 8: b += ((unsigned)k[7] << 24);
+    case 7: b += ((unsigned)k[6] << 16);
+    case 6: b += ((unsigned)k[5] << 8);
+    case 5: b += k[4];
+    case 4: a += ((unsigned)k[3] << 24);
+    case 3: a += ((unsigned)k[2] << 16);
+    case 2: a += ((unsigned)k[1] << 8);
+    case 1: a += k[0];
+    }
+
+    jen_mix(a, b, c);
+
+    return c;
+}
+
+static inline unsigned jen_hash(hashkey_t key)
+{
+    return jen_hash_seed(key, 0);
+}
+
+/* tabulation hashing.  https://en.wikipedia.org/wiki/Tabulation_hashing
+ *
+ * This is a universal hashing algorithm.  But not good enough to give 
+ * bounded insertion time for cockoo hashing, in general.  
+ *
+ * Note this is limited to 4 characters (i.e., bytes).  This can be extended to longer
+ * strings but the tables also grow large.  Handling long strings needs
+ * a different approach.  
+ *
+ */
+#define tab_TABLESIZE 256
+#define tab_MAXCHARS  4
+extern const unsigned int tab_Tab[tab_MAXCHARS][tab_TABLESIZE];
+
+static inline unsigned int tab_hash(hashkey_t key)
+{
+    int len = sizeof(key);
+    unsigned char *p = (unsigned char *) &key;
+    int i;
+    unsigned int h = 0;
+    assert(len <= tab_MAXCHARS);
+
+    for (i = 0; i < len; i++)
+    {
+        h ^= tab_Tab[i][p[i]];
+    }
+    return h;
+}
+
+/* Twisted tabulation (Patrascu and Thorup).  The entries are 64 bits.  The
+ * first three characters look up their tables as in tab_hash, and the top
+ * bits of the result are xored into the last character before it looks up
+ * the last table.  The last lookup then depends on all the characters, which
+ * gives Chernoff-style concentration that simple tabulation lacks, for the
+ * cost of one more xor.  The tables take 8 KB.
+ */
+extern const unsigned long long twt_Tab[tab_MAXCHARS][tab_TABLESIZE];
+
+static inline unsigned twt_hash(hashkey_t key)
+{
+    unsigned x = (unsigned) key;
+    unsigned long long h = twt_Tab[0][x & 0xff] ^ twt_Tab[1][(x >> 8) & 0xff]
+        ^ twt_Tab[2][(x >> 16) & 0xff];
+    unsigned last = ((x >> 24) ^ (unsigned) (h >> 32)) & 0xff;
+    return (unsigned) h ^ (unsigned) twt_Tab[3][last];
+}
+
+/* Word-at-a-time integer mixers.  The functions above walk the key one byte
+ * at a time through a char pointer, a chain of dependent steps per byte.
+ * These work on the whole key at once.
+ */
+
+/* murmur3 fmix32, the finalizer of MurmurHash3: two multiplies and three
+ * xor-shifts, every input bit affects every output bit.
+ */
+static inline unsigned mur_hash(hashkey_t key)
+{
+    unsigned h = (unsigned) key;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/* 64-bit multiply-xorshift, the splitmix64 finalizer.  The key is mixed in
+ * 64 bits and the low half returned, so the high product bits of both
+ * multiplies reach the result.
+ */
+static inline unsigned mxs_hash(hashkey_t key)
+{
+    unsigned long long h = (unsigned) key;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return (unsigned) h;
+}
+
+/* The key mixed with a seed before it is hashed, for tables with their own
+ * random seed (TABLE_RESEED).  Keys picked to collide under a fixed hash
+ * are sent to unrelated values by every seed, and without the seed it
+ * cannot be predicted which keys will collide.  A seed of 0 is never used.
+ */
+static inline hashkey_t hashes_seed_key(hashkey_t key, unsigned seed)
+{
+    return (hashkey_t) mur_hash((hashkey_t) ((unsigned) key ^ seed));
+}
+
+/* CRC32C (Castagnoli) of the 4 key bytes.  With SSE4.2 it is one crc32
+ * instruction.  hashes.c checks the CPU once at startup, so a build without
+ * -msse4.2 still uses the instruction where it exists, and falls back to a
+ * byte table that gives the same value.  The byte table is in hashes_tab.c.
+ * A CRC is linear over GF(2), so it spreads sequential keys well but is not
+ * a full avalanche mix.
+ */
+#define crc_TABLESIZE 256
+#define crc_POLY 0x82f63b78u
+extern const unsigned int crc_Tab[crc_TABLESIZE];
+extern int crc_Hardware;
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.2")))
+static inline unsigned crc_hash_sse42(hashkey_t key)
+{
+    return ~_mm_crc32_u32(~0u, (unsigned) key);
+}
+#endif
+
+static inline unsigned crc_hash(hashkey_t key)
+{
+#if defined(__SSE4_2__)
+    return crc_hash_sse42(key);
+#else
+#if defined(__x86_64__) || defined(__i386__)
+    if (crc_Hardware) {
+        return crc_hash_sse42(key);
+    }
+#endif
+    unsigned char *p = (unsigned char *) &key;
+    unsigned h = ~0u;
+    for (int i = 0; i < (int) sizeof(key); i++) {
+        h = crc_Tab[(h ^ p[i]) & 0xff] ^ (h >> 8);
+    }
+    return ~h;
+#endif
+}
+
+/* Hash value of key with algorithm alg.  When alg is a constant the switch
+ * folds away and the hash function is expanded in place.
+ */
+static inline unsigned hashes_hash_alg(int alg, hashkey_t key)
+{
+    switch (alg) {
+        case ABS_HASH: return abs(key);
+        case DJB_HASH: return djb_hash(key);
+        case SAX_HASH: return sax_hash(key);
+        case FNV_HASH: return fnv_hash(key);
+        case OAT_HASH: return oat_hash(key);
+        case JEN_HASH: return jen_hash(key);
+        case JSW_HASH: return jsw_hash(key);
+        case ELF_HASH: return elf_hash(key);
+        case TAB_HASH: return tab_hash(key);
+        case MUR_HASH: return mur_hash(key);
+        case MXS_HASH: return mxs_hash(key);
+        case CRC_HASH: return crc_hash(key);
+        case TWT_HASH: return twt_hash(key);
+        default:
+                       printf("\n\tInvalid Hash algorithm: %d\n", alg);
+                       printf("\t run ./lab6 -f help to see hash function options\n");
+    }
+    exit(1);
+}
+
+/* Reduce a hash value to a position in [0, size).
+ *
+ * A power of two size is reduced with a mask, which gives the same result as
+ * the mod.  Other sizes use the mod, unless hashes_reduction selected
+ * REDUCE_FAST.  Then the hash is scaled into range with a multiply and a
+ * shift (Lemire's fastrange), which uses the high bits of the hash and avoids
+ * the divide.  Only hashes that mix their high bits do well with this; the
+ * abs_hash of small keys maps everything to position 0.
+ *
+ * When the caller has the magic number from hashes_mod_magic for size, the
+ * mod is done with two multiplies instead of a divide (Lemire's fastmod).
+ * The result is exactly hash % size.  A magic of 0 means none is known.
+ */
+extern int HashReduction;
+
+static inline int hashes_reduce(unsigned hash, int size, unsigned long long magic)
+{
+    if ((size & (size - 1)) == 0) {
+        return hash & (size - 1);
+    } else if (HashReduction == REDUCE_FAST) {
+        return ((unsigned long long) hash * size) >> 32;
+    } else if (magic != 0) {
+        unsigned long long low = magic * hash;
+        return ((unsigned __int128) low * (unsigned) size) >> 64;
+    }
+    return hash % size;
+}
+
+/* Double hashing decrement in [1, size-1] from hash, the value of the
+ * table's own hash function for the key, see hashes_probe_dec.  The hash is
+ * multiplied out to 64 bits by 2^64/phi, and the high half of the product
+ * is scaled into range.  The home slot comes from hash itself, so the key is
+ * hashed only once, yet keys with the same home still get different
+ * decrements.
+ */
+static inline int hashes_dec_inline(unsigned hash, int size)
+{
+    unsigned mixed = ((unsigned long long) hash * 0x9e3779b97f4a7c15ULL) >> 32;
+    return 1 + (int) (((unsigned long long) mixed * (unsigned) (size - 1)) >> 32);
+}
@@ -11,13 +11,27 @@
  *
  *   -m to set the table size
  *   -a to set the load factor for -r and -e
- *   -h to set the type of probe sequence {linear|double|quad}
+ *   -h to set the type of probe sequence {linear|double|quad|robin|cuckoo|hop}
+ *   -o to enable an optional table mode
+ *      {ctrl|soa|bshift|auto|lockfree|inline|pool|hashes|reseed}.
+ *      Repeat -o for more than one.  With inline the -r, -e, and -p drivers store
+ *      their ints in the table slots instead of mallocing them, and with pool
+ *      they get them from the table's slabs.  The reseed seeds come from -s
+ *   -x to reduce hashes to table positions with {mod|fast} (multiply-shift)
  *
  * The -r driver builds a table using table_insert and then accesses
  * keys in the table using table_retrieve.  Use
  *   -r run the retrieve driver and specifiy the type of initial table keys 
  *      (rand|seq|fold|worst)
  *   -t to set the number of access trials 
+ *   -l to also compare single lookups with table_retrieve_batch, in batches
+ *      of the given size.  Also works with -e
+ *   -j to build the table with table_build_from_array and the given number
+ *      of threads instead of one table_insert per key.  Also works with -e
+ *   -g to rehash the -e table with table_rehash_threads and the given number
+ *      of threads
+ *   -z to clear the deleted markers of the -e table in place with
+ *      table_compact instead of rehashing it
  *
  * For debugging tests (also change -m to other values):
  *   -r -t10 -v -m 6 -h linear  
@@ -35,6 +49,15 @@
  *   -b -v -m 16 -h quad 
  *
  *
+ * To measure a TABLE_LOCKED table shared by 1, 2, ... N threads use -c N
+ *   -c 4 -m 65537 -a 0.5 -t 1000000
+ *   -c 4 -m 65537 -a 0.5 -t 1000000 -h double
+ * With -k K the threads share 2^K shards (see shard.h) of size -m / 2^K instead
+ *   -c 4 -m 65537 -a 0.5 -t 1000000 -k 4
+ * With -o lockfree -c N runs a stress test of a TABLE_LOCKFREE table instead,
+ * in which every thread inserts, deletes, and reads the same small set of keys
+ *   -c 4 -m 65537 -a 0.5 -t 1000000 -o lockfree
+ *
  * To test the Two Sum Problem use -p X for X in the set {1, 2, 3, 4}
  *    -p 1 -v
  *    -p 2 -v
@@ -46,10 +69,10 @@
  * To test random inserts and deletes.  This driver builds
  * an initial table with random keys, and then performs insertions and deletions
  * with equal probability.
- *   -e -t 20 -v -m 47 -h {linear|double|quad}
+ *   -e -t 20 -v -m 47 -h {linear|double|quad|robin}
  *
  * For performance analysis test large tables
- *   -r -m {65537|655373} -i {rand|seq} -h {linear|double|} -a {0.9 | 0.7 | etc}
+ *   -r -m {65537|655373} -i {rand|seq} -h {linear|double|robin} -a {0.9 | 0.7 | etc}
  *   -r -m 65536 -i {rand|seq} -h quad -a {0.9 | 0.7 | etc}
  *   -e -m 65537 -h {linear|double} -t {50000|100000}
  *   -e -m 65536 -h quad -t {50000|100000}
@@ -67,9 +90,11 @@
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "table.h"
 #include "hashes.h"
+#include "shard.h"
 
 /* constants used with Global variables */
 
@@ -87,7 +112,15 @@ enum TableType_t {RAND, SEQ, FOLD, WORST};
 int Verbose = FALSE;
 static int TableSize = 11;
 static int ProbeDec = LINEAR;
+static int TableMode = TABLE_PLAIN;
 static int HashAlg = ABS_HASH;
+static int HashReduce = REDUCE_MOD;
+static int BatchSize = 0;
+static int BulkThreads = 0;
+static int MaxThreads = 0;
+static int ShardBits = 0;
+static int RehashThreads = 0;
+static int CompactTest = FALSE;
 static double LoadFactor = 0.9;
 static int TableType = RAND;
 static int RetrieveTest = FALSE;
@@ -102,7 +135,11 @@ static int Seed = 11172024;
 /* prototypes for functions in this file only */
 void getCommandLine(int argc, char **argv);
 void equilibriumDriver(void);
+void batchThroughput(table_t *T);
+void threadedDriver(void);
+void stressDriver(void);
 void RetrieveDriver(void);
+void probeCountPrint(const char *, const int *, int, int);
 void RehashDriver(int);
 void TwoSumDriver(int);
 void specialDriver(void);
@@ -110,6 +147,11 @@ int build_random(table_t *T, int ,int);
 int build_seq(table_t *T, int, int);
 int build_fold(table_t *T, int, int);
 int build_worst(table_t *T, int, int);
+int build_bulk(table_t *T, int, int);
+data_t newInt(table_t *T, int value);
+int insertInt(table_t *T, hashkey_t K, int value);
+int retrieveInt(table_t *T, hashkey_t K, int *value);
+int deleteInt(table_t *T, hashkey_t K, int *value);
 void performanceFormulas(double);
 int find_first_prime(int number);
 void twoSum(const int* nums, const int numsSize, const int target, int *ans1, int *ans2);
@@ -125,9 +167,35 @@ int main(int argc, char **argv)
         printf("Open addressing with double hashing\n");
     else if (ProbeDec == QUAD)
         printf("Open addressing with quadratic probe sequence\n");
+    else if (ProbeDec == ROBIN_HOOD)
+        printf("Open addressing with Robin Hood linear probe sequence\n");
+    else if (ProbeDec == CUCKOO)
+        printf("Cuckoo hashing with 4 seeded jen_hash functions and a stash\n");
+    else if (ProbeDec == HOPSCOTCH)
+        printf("Open addressing with hopscotch neighborhoods of 63 slots\n");
+    if (TableMode & TABLE_CTRL)
+        printf("Table mode: control byte tags\n");
+    if (TableMode & TABLE_SOA)
+        printf("Table mode: separate key and data arrays\n");
+    if (TableMode & TABLE_BSHIFT)
+        printf("Table mode: backward shift deletion\n");
+    if (TableMode & TABLE_AUTORESIZE)
+        printf("Table mode: incremental automatic resizing\n");
+    if (TableMode & TABLE_LOCKFREE)
+        printf("Table mode: lock-free\n");
+    if (TableMode & TABLE_INLINE)
+        printf("Table mode: inline values\n");
+    if (TableMode & TABLE_POOL)
+        printf("Table mode: pooled data\n");
+    if (TableMode & TABLE_HASHES)
+        printf("Table mode: cached hashes\n");
+    if (TableMode & TABLE_RESEED)
+        printf("Table mode: seeded hashing with reseeds\n");
     hashes_configure(HashAlg);  // defaults to ABS_HASH
+    hashes_reduction(HashReduce);  // defaults to REDUCE_MOD
     printf("Seed: %d\n", Seed);
     srand48(Seed);
+    table_seed_base(Seed);
 
     /* ----- small table tests  ----- */
 
@@ -154,6 +222,12 @@ int main(int argc, char **argv)
     if (SpecialTest)                       /*enable with -q flag  */
         specialDriver();
 
+    /* many threads sharing one TABLE_LOCKED or TABLE_LOCKFREE table */
+    if (MaxThreads > 0 && (TableMode & TABLE_LOCKFREE))   /* -c and -o lockfree */
+        stressDriver();
+    else if (MaxThreads > 0)               /* enable with -c flag */
+        threadedDriver();
+
     return 0;
 }
 
@@ -161,7 +235,9 @@ void build_table(table_t *test_table, int num_keys)
 {
     int probes = -1;
     printf("  Build table with");
-    if (TableType == RAND) {
+    if (BulkThreads > 0) {
+        probes = build_bulk(test_table, TableSize, num_keys);
+    } else if (TableType == RAND) {
         printf(" %d random keys\n", num_keys);
         probes = build_random(test_table, TableSize, num_keys);
     } else if (TableType == SEQ) {
@@ -179,6 +255,8 @@ void build_table(table_t *test_table, int num_keys)
     }
     printf("    The average number of probes for a successful search = %g\n", 
             (double) probes/num_keys);
+    if (TableMode & TABLE_RESEED)
+        printf("    Reseeds during build = %d\n", table_reseeds(test_table));
 
     if (Verbose)
         table_debug_print(test_table);
@@ -187,6 +265,59 @@ void build_table(table_t *test_table, int num_keys)
     assert(size == num_keys);
 }
 
+/* The drivers store an int with each key.  It is malloced, or with -o pool
+ * taken from T's slabs, and passed as data_t, or with -o inline copied into
+ * the slot.
+ */
+data_t newInt(table_t *T, int value)
+{
+    data_t dp = NULL;
+    if (TableMode & TABLE_INLINE) {
+        memcpy(&dp, &value, sizeof(value));
+        return dp;
+    }
+    int *ip = (int *) table_alloc(T, sizeof(int));
+    *ip = value;
+    return ip;
+}
+
+/* Insert K with value, same return codes as table_insert */
+int insertInt(table_t *T, hashkey_t K, int value)
+{
+    if (TableMode & TABLE_INLINE)
+        return table_insert_value(T, K, &value, sizeof(value));
+    data_t dp = newInt(T, value);
+    int code = table_insert(T, K, dp);
+    if (code == -1)
+        table_free_data(T, dp);
+    return code;
+}
+
+/* Copy the value stored with K into *value.  Returns 1 if K was found */
+int retrieveInt(table_t *T, hashkey_t K, int *value)
+{
+    if (TableMode & TABLE_INLINE)
+        return table_retrieve_value(T, K, value, sizeof(*value));
+    int *ip = table_retrieve(T, K);
+    if (ip == NULL)
+        return 0;
+    *value = *ip;
+    return 1;
+}
+
+/* Remove K and copy its value into *value.  Returns 1 if K was found */
+int deleteInt(table_t *T, hashkey_t K, int *value)
+{
+    if (TableMode & TABLE_INLINE)
+        return table_delete_value(T, K, value, sizeof(*value));
+    int *ip = table_delete(T, K);
+    if (ip == NULL)
+        return 0;
+    *value = *ip;
+    table_free_data(T, ip);
+    return 1;
+}
+
 
 /* This driver tests special edge cases such as deleting a key not in table
  * deleting from empty table, inserting into a full table
@@ -200,8 +331,13 @@ void specialDriver() {
     int check_ins;
     int *ip;
 
+    if (TableMode & TABLE_AUTORESIZE) {
+        printf("The -q driver fills a fixed size table and does not work with -o auto\n");
+        exit(1);
+    }
+
     int nums_size = sizeof(nums)/sizeof(int);
-    table_t *table = table_construct(nums_size +1, ProbeDec);
+    table_t *table = table_construct_mode(nums_size +1, ProbeDec, TableMode);
     table_debug_print(table);
     data_t *check_del = table_delete(table, bad_test_key);
     assert(check_del == NULL);
@@ -278,16 +414,29 @@ void DeletionDriver()
     int *ip;
     table_t *H;
     int i, code;
-    H = table_construct(TABLESIZE, ProbeDec);
+    H = table_construct_mode(TABLESIZE, ProbeDec, TableMode);
     int key = 0;
     int keys[TABLESIZE];
     int locations[TABLESIZE] = {5, 5, 4, 5, 5, 5, 0};  // fix if change table size
 
     printf("\n----- Deletion driver for table size 7. Compare to HW8.6-----\n");
+    if (TableMode & TABLE_AUTORESIZE) {
+        printf("The -d driver uses a fixed table size of 7 and does not work with -o auto\n");
+        exit(1);
+    }
+    if (TableMode & TABLE_LOCKFREE) {
+        printf("The -d driver checks keys marked deleted and does not work with -o lockfree\n");
+        exit(1);
+    }
     if (ProbeDec == QUAD) {
         printf("The -d driver uses a table size of 7.  Quadratic probing will not work correctly\n");
         exit(1);
     }
+    if (ProbeDec == ROBIN_HOOD || ProbeDec == CUCKOO || ProbeDec == HOPSCOTCH
+            || (TableMode & TABLE_BSHIFT)) {
+        printf("The -d driver checks keys marked deleted.  Robin Hood, cuckoo, hopscotch, and -o bshift tables do not mark keys\n");
+        exit(1);
+    }
     if (ProbeDec != LINEAR) {
         printf("\n\tThis driver works best with linear probing but can work with double\n\n");
     }
@@ -392,7 +541,7 @@ void DeletionFullDriver()
     int *ip;
     table_t *H;
     int i, code;
-    H = table_construct(TABLESIZE, ProbeDec);
+    H = table_construct_mode(TABLESIZE, ProbeDec, TableMode);
 
     int keys[DFD_KEYS];
     int locations[DFD_KEYS] = {0, 1, 2, 3, 4, 5, 6, 0, 2};  // fix if change num keys 
@@ -508,6 +657,19 @@ void RehashDriver(int test_M)
         printf("\n\t the -b driver only works with -f abs\n");
         exit(1);
     }
+    if (ProbeDec == ROBIN_HOOD || ProbeDec == CUCKOO || ProbeDec == HOPSCOTCH
+            || (TableMode & TABLE_BSHIFT)) {
+        printf("\n\t the -b driver checks keys marked deleted and does not work with -h robin, cuckoo, hop, or -o bshift\n");
+        exit(1);
+    }
+    if (TableMode & TABLE_AUTORESIZE) {
+        printf("\n\t the -b driver fills a fixed size table and does not work with -o auto\n");
+        exit(1);
+    }
+    if (TableMode & TABLE_LOCKFREE) {
+        printf("\n\t the -b driver checks keys marked deleted and does not work with -o lockfree\n");
+        exit(1);
+    }
     if (test_M < 6) {
         printf("\nRehashDriver designed for table size for at least 6\n");
         printf("Re-run with -m x for x in this range\n");
@@ -517,7 +679,7 @@ void RehashDriver(int test_M)
     assert(startkey%test_M == 0);
     assert(test_M > 5);  // tests designed for size at least 6
 
-    H = table_construct(test_M, ProbeDec);
+    H = table_construct_mode(test_M, ProbeDec, TableMode);
     // fill table sequentially 
     //
     // Fix: need to find keys that hash in sequential locations if
@@ -760,6 +922,39 @@ void RehashDriver(int test_M)
     printf("----- Passed rehash driver -----\n\n");
 }
 
+/* Upper end of each bucket of the probe count distribution */
+#define PROBE_BUCKETS 9
+static const int ProbeBucketTop[PROBE_BUCKETS] = {1, 2, 3, 4, 5, 8, 16, 32, INT_MAX};
+
+static int probeBucket(int probes)
+{
+    int b = 0;
+    while (probes > ProbeBucketTop[b])
+        b++;
+    return b;
+}
+
+/* Print the percent of searches in each bucket of a probe count distribution
+ * Inputs: name of the search, count of searches in each bucket, number of
+ *         searches, and the most probes for any one search
+ */
+void probeCountPrint(const char *name, const int *count, int trials, int max_probes)
+{
+    int b;
+    printf("    Probe distribution for %s search (max %d):\n     ", name, max_probes);
+    for (b = 0; b < PROBE_BUCKETS; b++) {
+        int low = b == 0 ? 1 : ProbeBucketTop[b-1] + 1;
+        if (ProbeBucketTop[b] == INT_MAX)
+            printf(" >%d:", low - 1);
+        else if (low == ProbeBucketTop[b])
+            printf(" %d:", low);
+        else
+            printf(" %d-%d:", low, ProbeBucketTop[b]);
+        printf("%.1f%%", 100.0 * count[b] / trials);
+    }
+    printf("\n");
+}
+
 /* driver to build and test tables. Note this driver  
  * does not delete keys from the table.
  */
@@ -768,9 +963,11 @@ void RetrieveDriver()
     int i;
     int key_range, num_keys;
     int suc_search, suc_trials, unsuc_search, unsuc_trials;
+    int suc_count[PROBE_BUCKETS] = {0}, unsuc_count[PROBE_BUCKETS] = {0};
+    int suc_max = 0, unsuc_max = 0, probes;
+    int value;
     table_t *test_table;
     hashkey_t key;
-    data_t dp;
 
     /* print parameters for this test run */
     printf("\n----- Retrieve driver -----\n");
@@ -778,7 +975,7 @@ void RetrieveDriver()
     printf("  Trials: %d\n", Trials);
 
     num_keys = (int) (TableSize * LoadFactor);
-    test_table = table_construct(TableSize, ProbeDec);
+    test_table = table_construct_mode(TableSize, ProbeDec, TableMode);
 
     build_table(test_table, num_keys);
 
@@ -797,10 +994,13 @@ void RetrieveDriver()
                 }
                 printf("\n");
             }
-            dp = table_retrieve(test_table, key);
-            if (dp == NULL) {
-                unsuc_search += table_stats(test_table);
+            if (!retrieveInt(test_table, key, &value)) {
+                probes = table_stats(test_table);
+                unsuc_search += probes;
                 unsuc_trials++;
+                unsuc_count[probeBucket(probes)]++;
+                if (probes > unsuc_max)
+                    unsuc_max = probes;
                 if (Verbose)
                     printf("\t not found with %d probes\n", 
                             table_stats(test_table));
@@ -811,7 +1011,7 @@ void RetrieveDriver()
                 if (Verbose)
                     printf("\t\t FOUND with %d probes (this is rare!)\n", 
                             table_stats(test_table));
-                assert(*(int *)dp == key);
+                assert(value == key);
             }
         }
         assert(num_keys == table_entries(test_table));
@@ -821,6 +1021,26 @@ void RetrieveDriver()
         if (unsuc_trials > 0)
             printf("    Avg probes for unsuccessful search = %g measured with %d trials\n", 
                     (double) unsuc_search/unsuc_trials, unsuc_trials);
+
+        /* every stored key once, for the successful search distribution */
+        suc_trials = 0;
+        for (i = 0; i < table_slots(test_table); i++) {
+            key = table_peek(test_table, i);
+            if (key == PEEK_NOKEY)
+                continue;
+            assert(retrieveInt(test_table, key, &value) && value == key);
+            probes = table_stats(test_table);
+            suc_count[probeBucket(probes)]++;
+            if (probes > suc_max)
+                suc_max = probes;
+            suc_trials++;
+        }
+        if (suc_trials > 0)
+            probeCountPrint("successful", suc_count, suc_trials, suc_max);
+        if (unsuc_trials > 0)
+            probeCountPrint("unsuccessful", unsuc_count, unsuc_trials, unsuc_max);
+        if (BatchSize > 0)
+            batchThroughput(test_table);
     }
 
     /* print expected values from analysis with compare to experimental
@@ -868,8 +1088,6 @@ void twoSum(const int* nums, const int numsSize, const int target, int *ans1, in
 {
     int check_ins;
     int complement;
-    data_t *check_look; 
-    int *ip;
 
     int table_size = 2*numsSize; //default for linear
     if (ProbeDec == DOUBLE) {
@@ -881,14 +1099,13 @@ void twoSum(const int* nums, const int numsSize, const int target, int *ans1, in
         }
     }
 
-    table_t *table = table_construct(table_size, ProbeDec);
+    table_t *table = table_construct_mode(table_size, ProbeDec, TableMode);
 
     //place ints as keys in hash table, place num_index as data
     for (int i = 0; i < numsSize; i++) {
         complement = target - nums[i]; //calculate solution 2
-        check_look = table_retrieve(table, complement); //check if sol 2 already in hash table
-        if (check_look != NULL) { //if it was, check look contains the index it was at
-            *ans1 = *(int *)check_look;
+        if (retrieveInt(table, complement, ans1)) { //check if sol 2 already in hash table
+            //if it was, ans1 is the index it was at
             *ans2 = i;
             if (*ans1 == *ans2) {
                 continue; //can't be the same index
@@ -897,9 +1114,7 @@ void twoSum(const int* nums, const int numsSize, const int target, int *ans1, in
             break;
         }
         //solution not already in table
-        ip = (int *)malloc(sizeof(int));
-        *ip = i;
-        check_ins = table_insert(table, nums[i], ip);
+        check_ins = insertInt(table, nums[i], i);
         //check return values of this
         assert(check_ins == 0);
     }
@@ -1067,6 +1282,470 @@ void TwoSumDriver(int twosumcase)
 
 }
 
+/* Compare table_retrieve with table_retrieve_batch on the same keys, with -l.
+ * The first pass looks up every key in the table and the second looks up
+ * Trials random keys, which nearly all miss.  Both paths must give the same
+ * answers.  The random keys come from a separate generator so the rest of
+ * the driver sees the same sequence with or without -l.
+ */
+void batchThroughput(table_t *T)
+{
+    int n, i, j, pass;
+    int key_range = MAXID - MINID + 1;
+    int max_n = table_entries(T) > Trials ? table_entries(T) : Trials;
+    unsigned short xsubi[3] = {Seed & 0xffff, Seed >> 16, 0x330e};
+    hashkey_t *keys = (hashkey_t *) malloc(max_n * sizeof(hashkey_t));
+    data_t *single = (data_t *) malloc(max_n * sizeof(data_t));
+    data_t *batch = (data_t *) malloc(max_n * sizeof(data_t));
+    clock_t start, end;
+    double single_ms, batch_ms;
+
+    for (pass = 0; pass < 2; pass++) {
+        n = 0;
+        if (pass == 0) {
+            for (i = 0; i < table_slots(T); i++) {
+                hashkey_t key = table_peek(T, i);
+                if (key != PEEK_NOKEY)
+                    keys[n++] = key;
+            }
+            /* shuffle so the lookups do not walk the table in order */
+            for (i = n - 1; i > 0; i--) {
+                j = (int) (erand48(xsubi) * (i + 1));
+                hashkey_t tmp = keys[i];
+                keys[i] = keys[j];
+                keys[j] = tmp;
+            }
+        } else {
+            for (n = 0; n < Trials; n++)
+                keys[n] = (hashkey_t) (erand48(xsubi) * key_range) + MINID;
+        }
+        if (n == 0)
+            continue;
+
+        start = clock();
+        for (i = 0; i < n; i++)
+            single[i] = table_retrieve(T, keys[i]);
+        end = clock();
+        single_ms = 1000*((double)(end-start))/CLOCKS_PER_SEC;
+
+        start = clock();
+        for (i = 0; i < n; i += BatchSize)
+            table_retrieve_batch(T, keys + i, n - i < BatchSize ? n - i : BatchSize,
+                    batch + i);
+        end = clock();
+        batch_ms = 1000*((double)(end-start))/CLOCKS_PER_SEC;
+
+        for (i = 0; i < n; i++) {
+            if (single[i] != batch[i]) {
+                printf("!!! batch retrieve of key (%d) does not match retrieve\n", keys[i]);
+                exit(17);
+            }
+        }
+        printf("  %s lookups: %d keys, batches of %d\n",
+                pass == 0 ? "Stored key" : "Random key", n, BatchSize);
+        printf("    single retrieve time=%g, %g Mlookups/sec\n",
+                single_ms, single_ms > 0 ? n / single_ms / 1000 : 0.0);
+        printf("    batch retrieve time=%g, %g Mlookups/sec\n",
+                batch_ms, batch_ms > 0 ? n / batch_ms / 1000 : 0.0);
+    }
+    free(keys);
+    free(single);
+    free(batch);
+}
+
+/* State for one thread of threadedDriver.  Each thread owns the keys in its
+ * keys array: it inserted them or was handed them from the initial build.
+ * Only the owner deletes a key, so a delete of an owned key must succeed.
+ * The threads share either table or, with -k, shards.
+ */
+typedef struct worker_tag {
+    table_t *table;
+    shard_t *shards;
+    int trials;
+    unsigned short xsubi[3];
+    hashkey_t *keys;
+    int num_keys;
+    int max_keys;
+    int added, removed, replaced, full;
+} worker_t;
+
+static int worker_insert(worker_t *w, hashkey_t key, data_t dp)
+{
+    return w->shards != NULL ? shard_insert(w->shards, key, dp) : table_insert(w->table, key, dp);
+}
+
+static data_t worker_delete(worker_t *w, hashkey_t key)
+{
+    return w->shards != NULL ? shard_delete(w->shards, key) : table_delete(w->table, key);
+}
+
+static data_t worker_retrieve(worker_t *w, hashkey_t key)
+{
+    return w->shards != NULL ? shard_retrieve(w->shards, key) : table_retrieve(w->table, key);
+}
+
+static int worker_entries(worker_t *w)
+{
+    return w->shards != NULL ? shard_entries(w->shards) : table_entries(w->table);
+}
+
+void *threadedWorker(void *arg)
+{
+    worker_t *w = (worker_t *) arg;
+    int key_range = MAXID - MINID + 1;
+    int i, j, code;
+    int *ip;
+    hashkey_t key;
+    data_t dp;
+
+    for (i = 0; i < w->trials; i++) {
+        double op = erand48(w->xsubi);
+        if (op < 0.5) {
+            /* reader: random key, nearly always a miss.  The data of a key
+             * another thread owns may be freed as soon as the lock is
+             * released, so it is never read.
+             */
+            key = (hashkey_t) (erand48(w->xsubi) * key_range) + MINID;
+            worker_retrieve(w, key);
+        } else if (op < 0.75 && w->num_keys < w->max_keys) {
+            key = (hashkey_t) (erand48(w->xsubi) * key_range) + MINID;
+            ip = (int *) malloc(sizeof(int));
+            *ip = key;
+            code = worker_insert(w, key, ip);
+            if (code == 0) {
+                w->keys[w->num_keys++] = key;
+                w->added++;
+            } else if (code == 1) {
+                w->replaced++;   /* owned by some other thread */
+            } else {
+                free(ip);
+                w->full++;
+            }
+        } else if (w->num_keys > 0 && worker_entries(w) > TableSize/4) {
+            j = (int) (erand48(w->xsubi) * w->num_keys);
+            key = w->keys[j];
+            dp = worker_delete(w, key);
+            if (dp == NULL || *(int *)dp != key) {
+                printf("!!! failed to delete owned key (%d)\n", key);
+                exit(19);
+            }
+            free(dp);
+            w->keys[j] = w->keys[--w->num_keys];
+            w->removed++;
+        }
+    }
+    return NULL;
+}
+
+/* Build the shards for threadedDriver with num_keys random keys and deal
+ * the keys out to the first nthreads workers.  Each shard starts with
+ * 1/2^-k of the -m slots.
+ */
+shard_t *build_shards(worker_t *workers, int nthreads, int num_keys)
+{
+    int shard_size = TableSize >> ShardBits;
+    int range = MAXID - MINID + 1;
+    int i, t, code;
+    int *ip;
+    hashkey_t key;
+    shard_t *S;
+
+    if (ProbeDec == DOUBLE && shard_size > 1)
+        shard_size = find_first_prime(shard_size);
+    if (shard_size < 2) {
+        printf("Table size %d is too small for %d shards\n", TableSize, 1 << ShardBits);
+        exit(1);
+    }
+    S = shard_construct(ShardBits, shard_size, ProbeDec, TableMode);
+    printf("  Build %d shards of size %d with %d random keys\n", 1 << ShardBits,
+            shard_size, num_keys);
+    for (i = 0, t = 0; i < num_keys; i++) {
+        key = (hashkey_t) (drand48() * range) + MINID;
+        ip = (int *) malloc(sizeof(int));
+        *ip = key;
+        code = shard_insert(S, key, ip);
+        if (code == 1) {
+            i--;   // duplicate key, already dealt to a thread
+        } else if (code != 0) {
+            printf("build of shards failed code (%d) index (%d) key (%d)\n", code, i, key);
+            exit(2);
+        } else {
+            workers[t].keys[workers[t].num_keys++] = key;
+            t = (t + 1) % nthreads;
+        }
+    }
+    return S;
+}
+
+/* Equilibrium test with many threads sharing one TABLE_LOCKED table, or
+ * with -k the shards of a shard_t.  For each thread count from 1 to -c,
+ * build a table at the -a load factor and run Trials operations split over
+ * the threads: half retrieves of random keys, a quarter inserts, and a
+ * quarter deletes of keys the thread owns.  Reports the total operations
+ * per second, then checks that every owned key is still in the table.  With
+ * -k the load of each shard is printed too.
+ *
+ * The deletes leave deleted markers behind, and once they fill the table
+ * every search runs through all of it.  So the trials run in rounds of at
+ * most half the -m operations, and between rounds a single table is
+ * rehashed, outside the timed part.  Shards rehash themselves.
+ */
+void threadedDriver(void)
+{
+    int nthreads, t, i, num_keys, expected;
+    int round_ops, round = 0, done, rehashes;
+    worker_t *workers;
+    pthread_t *tids;
+    table_t *test_table = NULL;
+    shard_t *test_shards = NULL;
+    struct timespec wall_start, wall_end;
+    double ms;
+
+    printf("\n----- Threaded equilibrium driver -----\n");
+    printf("Table size (%d), load factor (%g)\n", TableSize, LoadFactor);
+    printf("  Trials: %d, threads 1 to %d\n", Trials, MaxThreads);
+    num_keys = (int) (TableSize * LoadFactor);
+    workers = (worker_t *) malloc(MaxThreads * sizeof(worker_t));
+    tids = (pthread_t *) malloc(MaxThreads * sizeof(pthread_t));
+
+    round_ops = TableSize / 2 > 0 ? TableSize / 2 : 1;
+    for (nthreads = 1; nthreads <= MaxThreads; nthreads++) {
+        /* deal the initial keys out to the threads */
+        for (t = 0; t < nthreads; t++) {
+            workers[t].trials = Trials / nthreads;
+            workers[t].xsubi[0] = Seed & 0xffff;
+            workers[t].xsubi[1] = Seed >> 16;
+            workers[t].xsubi[2] = t;
+            workers[t].max_keys = TableSize;
+            workers[t].keys = (hashkey_t *) malloc(TableSize * sizeof(hashkey_t));
+            workers[t].num_keys = 0;
+            workers[t].added = workers[t].removed = 0;
+            workers[t].replaced = workers[t].full = 0;
+        }
+        if (ShardBits > 0) {
+            test_shards = build_shards(workers, nthreads, num_keys);
+        } else {
+            test_table = table_construct_mode(TableSize, ProbeDec, TableMode | TABLE_LOCKED);
+            build_table(test_table, num_keys);
+            t = 0;
+            for (i = 0; i < TableSize; i++) {
+                hashkey_t key = table_peek(test_table, i);
+                if (key != PEEK_NOKEY) {
+                    workers[t].keys[workers[t].num_keys++] = key;
+                    t = (t + 1) % nthreads;
+                }
+            }
+        }
+        ms = 0;
+        rehashes = 0;
+        for (done = 0; done < Trials / nthreads; done += round) {
+            round = round_ops / nthreads > 0 ? round_ops / nthreads : 1;
+            if (round > Trials / nthreads - done)
+                round = Trials / nthreads - done;
+            if (done > 0 && test_table != NULL) {
+                test_table = table_rehash(test_table, TableSize);
+                rehashes++;
+            }
+            for (t = 0; t < nthreads; t++) {
+                workers[t].trials = round;
+                workers[t].table = test_table;
+                workers[t].shards = test_shards;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &wall_start);
+            for (t = 0; t < nthreads; t++) {
+                if (pthread_create(&tids[t], NULL, threadedWorker, &workers[t]) != 0) {
+                    printf("Failed to create thread %d\n", t);
+                    exit(1);
+                }
+            }
+            for (t = 0; t < nthreads; t++)
+                pthread_join(tids[t], NULL);
+            clock_gettime(CLOCK_MONOTONIC, &wall_end);
+            ms += 1000*(wall_end.tv_sec - wall_start.tv_sec)
+                + (wall_end.tv_nsec - wall_start.tv_nsec)/1e6;
+        }
+        for (t = 0; t < nthreads; t++)
+            workers[t].trials = Trials / nthreads;
+
+        expected = 0;
+        for (t = 0; t < nthreads; t++) {
+            for (i = 0; i < workers[t].num_keys; i++) {
+                data_t dp = worker_retrieve(&workers[t], workers[t].keys[i]);
+                if (dp == NULL || *(int *)dp != workers[t].keys[i]) {
+                    printf("!!! owned key (%d) missing after threaded trials\n",
+                            workers[t].keys[i]);
+                    exit(20);
+                }
+            }
+            expected += workers[t].num_keys;
+        }
+        assert(expected == worker_entries(&workers[0]));
+        printf("  %d threads: %d ops, time=%g, %g Mops/sec, keys %d\n",
+                nthreads, workers[0].trials * nthreads, ms,
+                ms > 0 ? workers[0].trials * nthreads / ms / 1000 : 0.0,
+                worker_entries(&workers[0]));
+        if (rehashes > 0)
+            printf("    rehashed %d times between rounds of %d ops\n", rehashes,
+                    round_ops / nthreads * nthreads);
+        for (t = 0; t < nthreads; t++)
+            free(workers[t].keys);
+        if (test_shards != NULL) {
+            shard_print_load(test_shards);
+            shard_destruct(test_shards);
+        } else {
+            table_destruct(test_table);
+        }
+    }
+    free(workers);
+    free(tids);
+    printf("----- End of threaded equilibrium driver -----\n\n");
+}
+
+/* State for one thread of stressDriver.  All threads work on the same keys,
+ * so counts are kept per thread and added up at the end.
+ */
+typedef struct stress_tag {
+    table_t *table;
+    int trials;
+    int num_keys;
+    unsigned short xsubi[3];
+    int added, removed, replaced, found;
+} stress_t;
+
+void *stressWorker(void *arg)
+{
+    stress_t *w = (stress_t *) arg;
+    int i, code;
+    int *ip;
+    hashkey_t key;
+    data_t dp;
+
+    for (i = 0; i < w->trials; i++) {
+        double op = erand48(w->xsubi);
+        key = (hashkey_t) (erand48(w->xsubi) * w->num_keys);
+        if (op < 0.6) {
+            /* the data may be deleted or replaced by another thread at any
+             * time, but it must not be freed before the epoch ends */
+            table_epoch_enter(w->table);
+            dp = table_retrieve(w->table, key);
+            if (dp != NULL) {
+                if (*(int *)dp != key) {
+                    printf("!!! retrieve of key (%d) returned freed or wrong data\n", key);
+                    exit(21);
+                }
+                w->found++;
+            }
+            table_epoch_exit(w->table);
+        } else if (op < 0.8) {
+            ip = (int *) malloc(sizeof(int));
+            *ip = key;
+            code = table_insert(w->table, key, ip);
+            if (code == 0) {
+                w->added++;
+            } else if (code == 1) {
+                w->replaced++;
+            } else {
+                free(ip);
+            }
+        } else {
+            dp = table_delete(w->table, key);
+            if (dp != NULL) {
+                if (*(int *)dp != key) {
+                    printf("!!! delete of key (%d) returned wrong data\n", key);
+                    exit(21);
+                }
+                table_retire(w->table, dp);
+                w->removed++;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Stress test for a TABLE_LOCKFREE table.  For each thread count from 1 to
+ * -c, Trials operations are split over the threads, all on keys 0 to
+ * -a*-m/2 so that threads keep inserting, replacing, and deleting the same
+ * keys under each other: 60% retrieves, 20% inserts, and 20% deletes.  Each
+ * payload holds its key, so a reader that is handed freed memory will
+ * usually see the wrong key.  At the end the number of keys in the table
+ * must match the inserts and deletes that succeeded, and every key left must
+ * have its own data.  The keys are kept few because a TABLE_LOCKFREE table
+ * only frees the slot of a deleted key in table_rehash.
+ */
+void stressDriver(void)
+{
+    int nthreads, t, i, num_keys, expected, found;
+    stress_t *workers;
+    pthread_t *tids;
+    table_t *test_table;
+    struct timespec wall_start, wall_end;
+    double ms;
+
+    num_keys = (int) (TableSize * LoadFactor / 2);
+    if (num_keys < 1)
+        num_keys = 1;
+    printf("\n----- Lock-free stress driver -----\n");
+    printf("Table size (%d), keys 0 to %d\n", TableSize, num_keys - 1);
+    printf("  Trials: %d, threads 1 to %d\n", Trials, MaxThreads);
+    workers = (stress_t *) malloc(MaxThreads * sizeof(stress_t));
+    tids = (pthread_t *) malloc(MaxThreads * sizeof(pthread_t));
+
+    for (nthreads = 1; nthreads <= MaxThreads; nthreads++) {
+        test_table = table_construct_mode(TableSize, ProbeDec, TableMode);
+        for (t = 0; t < nthreads; t++) {
+            workers[t].table = test_table;
+            workers[t].trials = Trials / nthreads;
+            workers[t].num_keys = num_keys;
+            workers[t].xsubi[0] = Seed & 0xffff;
+            workers[t].xsubi[1] = Seed >> 16;
+            workers[t].xsubi[2] = t;
+            workers[t].added = workers[t].removed = 0;
+            workers[t].replaced = workers[t].found = 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &wall_start);
+        for (t = 0; t < nthreads; t++) {
+            if (pthread_create(&tids[t], NULL, stressWorker, &workers[t]) != 0) {
+                printf("Failed to create thread %d\n", t);
+                exit(1);
+            }
+        }
+        for (t = 0; t < nthreads; t++)
+            pthread_join(tids[t], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &wall_end);
+        ms = 1000*(wall_end.tv_sec - wall_start.tv_sec)
+            + (wall_end.tv_nsec - wall_start.tv_nsec)/1e6;
+
+        expected = 0;
+        for (t = 0; t < nthreads; t++)
+            expected += workers[t].added - workers[t].removed;
+        found = 0;
+        for (i = 0; i < num_keys; i++) {
+            data_t dp = table_retrieve(test_table, i);
+            if (dp != NULL) {
+                if (*(int *)dp != i) {
+                    printf("!!! key (%d) has wrong data after stress trials\n", i);
+                    exit(22);
+                }
+                found++;
+            }
+        }
+        if (found != expected || found != table_entries(test_table)) {
+            printf("!!! %d keys in table, %d counted, %d expected\n",
+                    found, table_entries(test_table), expected);
+            exit(22);
+        }
+        printf("  %d threads: %d ops, time=%g, %g Mops/sec, keys %d\n",
+                nthreads, workers[0].trials * nthreads, ms,
+                ms > 0 ? workers[0].trials * nthreads / ms / 1000 : 0.0, found);
+        table_destruct(test_table);
+    }
+    free(workers);
+    free(tids);
+    printf("----- End of lock-free stress driver -----\n\n");
+}
+
 /* driver to test sequence of inserts and deletes.
 */
 void equilibriumDriver(void)
@@ -1077,18 +1756,23 @@ void equilibriumDriver(void)
     int ran_index;
     int suc_search, suc_trials, unsuc_search, unsuc_trials;
     int keys_added, keys_removed;
-    int *ip;
+    int value;
     table_t *test_table;
     hashkey_t key;
-    data_t dp;
     clock_t start, end;
+    struct timespec wall_start, wall_end;
 
     /* print parameters for this test run */
     printf("\n----- Equilibrium test driver -----\n");
     printf("Table size (%d), load factor (%g)\n", TableSize, LoadFactor);
     printf("  Trials: %d\n", Trials);
+    if (TableMode & TABLE_LOCKFREE) {
+        printf("The -e driver keeps inserting new keys, which use up the slots of\n");
+        printf("a -o lockfree table, and does not work with -o lockfree\n");
+        exit(1);
+    }
 
-    test_table = table_construct(TableSize, ProbeDec);
+    test_table = table_construct_mode(TableSize, ProbeDec, TableMode);
     num_keys = (int) (TableSize * LoadFactor);
 
     /* build a table as starting point */
@@ -1104,11 +1788,9 @@ void equilibriumDriver(void)
         if (drand48() < 0.5 && table_full(test_table) == FALSE) {
             // insert only if table not full
             key = (hashkey_t) (drand48() * key_range) + MINID;
-            ip = (int *) malloc(sizeof(int));
-            *ip = key;
             /* insert returns 0 if key not found, 1 if older key found */
             if (Verbose) printf("Trial %d, Insert Key %d", i, key);
-            code = table_insert(test_table, key, ip);
+            code = insertInt(test_table, key, key);
             if (code == 0) {
                 /* key was not in table so added */
                 unsuc_search += table_stats(test_table);
@@ -1128,7 +1810,7 @@ void equilibriumDriver(void)
             // why 25%?  Would 10% be better?  Lower than 10% will
             // be computationally expensive
             do {
-                ran_index = (int) (drand48() * TableSize);
+                ran_index = (int) (drand48() * table_slots(test_table));
                 key = table_peek(test_table, ran_index);
             } while (key == PEEK_NOKEY);
             if (Verbose) printf("Trial %d, Delete Key %d", i, key);
@@ -1137,14 +1819,12 @@ void equilibriumDriver(void)
                 printf("\n\n  table peek failed: invalid key (%d) during trial (%d)\n", key, i);
                 exit(12);
             }
-            dp = table_delete(test_table, key);
-            if (dp != NULL) {
+            if (deleteInt(test_table, key, &value)) {
                 if (Verbose) printf(" removed\n");
                 suc_search += table_stats(test_table);
                 suc_trials++;
                 keys_removed++;
-                assert(*(int *)dp == key);
-                free(dp);
+                assert(value == key);
             } else {
                 printf("!!! failed to find key (%d) in table, trial (%d)!\n", key, i);
                 printf("this is a catastrophic error!!!\n");
@@ -1176,58 +1856,79 @@ void equilibriumDriver(void)
     suc_search = suc_trials = unsuc_search = unsuc_trials = 0;
     start = clock();
     /* check each position in table for key */
-    for (i = 0; i < TableSize; i++) {
+    for (i = 0; i < table_slots(test_table); i++) {
         key = table_peek(test_table, i);
         if (key != PEEK_NOKEY) {
             assert(MINID <= key && key <= MAXID);
-            dp = table_retrieve(test_table, key);
-            if (dp == NULL) {
+            if (!retrieveInt(test_table, key, &value)) {
                 printf("Failed to find key (%d) but it is in location (%d)\n", 
                         key, i);
                 exit(16);
             } else {
                 suc_search += table_stats(test_table);
                 suc_trials++;
-                assert(*(int *)dp == key);
+                assert(value == key);
             }
         }
     }
     for (i = 0; i < Trials; i++) {
         /* random key with uniform distribution */
         key = (hashkey_t) (drand48() * key_range) + MINID;
-        dp = table_retrieve(test_table, key);
-        if (dp == NULL) {
+        if (!retrieveInt(test_table, key, &value)) {
             unsuc_search += table_stats(test_table);
             unsuc_trials++;
         } else {
             // this should be very rare
-            assert(*(int *)dp == key);
+            assert(value == key);
         }
     }
     end = clock();
     size = table_entries(test_table);
     printf("  After retrieve experiment, time=%g\n",
             1000*((double)(end-start))/CLOCKS_PER_SEC);
-    printf("  New load factor = %g\n", (double) size/TableSize);
+    if (table_slots(test_table) != TableSize)
+        printf("  Table resized to %d slots\n", table_slots(test_table));
+    printf("  New load factor = %g\n", (double) size/table_slots(test_table));
     printf("  Percent empty locations marked deleted = %g\n",
             (double) 100.0 * table_deletekeys(test_table)
-            / (TableSize - table_entries(test_table)));
+            / (table_slots(test_table) - table_entries(test_table)));
 
     printf("   Measured avg probes for successful search=%g, trials=%d\n", 
             (double) suc_search/suc_trials, suc_trials);
 
     printf("   Measured avg probes for unsuccessful search=%g, trials=%d\n", 
             (double) unsuc_search/unsuc_trials, unsuc_trials);
+    if (BatchSize > 0)
+        batchThroughput(test_table);
     if (TableSize > 100) {
         printf("    Do deletions increase avg number of probes?\n");
-        performanceFormulas((double) size/TableSize);
+        performanceFormulas((double) size/table_slots(test_table));
     } else {
         printf("\n\tRun with table size at least 101 (-m 101).  Try -m 65537 and 655373\n\n");
     }
 
     /* rehash and retest table */
-    printf("  Rehash table\n");
-    test_table = table_rehash(test_table, TableSize);
+    start = clock();
+    if (RehashThreads > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &wall_start);
+        test_table = table_rehash_threads(test_table, table_slots(test_table), RehashThreads);
+        clock_gettime(CLOCK_MONOTONIC, &wall_end);
+        end = clock();
+        printf("  Rehash table with %d threads, time=%g, cpu time=%g\n", RehashThreads,
+                1000*(wall_end.tv_sec - wall_start.tv_sec)
+                + (wall_end.tv_nsec - wall_start.tv_nsec)/1e6,
+                1000*((double)(end-start))/CLOCKS_PER_SEC);
+    } else if (CompactTest) {
+        table_compact(test_table);
+        end = clock();
+        printf("  Compact table, time=%g\n",
+                1000*((double)(end-start))/CLOCKS_PER_SEC);
+    } else {
+        test_table = table_rehash(test_table, table_slots(test_table));
+        end = clock();
+        printf("  Rehash table, time=%g\n",
+                1000*((double)(end-start))/CLOCKS_PER_SEC);
+    }
     /* number entries in table should not change */
     assert(size == table_entries(test_table));
     /* rehashing must clear all entries marked for deletion */
@@ -1238,32 +1939,30 @@ void equilibriumDriver(void)
     suc_search = suc_trials = unsuc_search = unsuc_trials = 0;
     start = clock();
     /* check each position in table for key */
-    for (i = 0; i < TableSize; i++) {
+    for (i = 0; i < table_slots(test_table); i++) {
         key = table_peek(test_table, i);
         if (key != PEEK_NOKEY) {
             assert(MINID <= key && key <= MAXID);
-            dp = table_retrieve(test_table, key);
-            if (dp == NULL) {
+            if (!retrieveInt(test_table, key, &value)) {
                 printf("Failed to find key (%d) after rehash but it is in location (%d)\n", 
                         key, i);
                 exit(26);
             } else {
                 suc_search += table_stats(test_table);
                 suc_trials++;
-                assert(*(int *)dp == key);
+                assert(value == key);
             }
         }
     }
     for (i = 0; i < Trials; i++) {
         /* random key with uniform distribution */
         key = (hashkey_t) (drand48() * key_range) + MINID;
-        dp = table_retrieve(test_table, key);
-        if (dp == NULL) {
+        if (!retrieveInt(test_table, key, &value)) {
             unsuc_search += table_stats(test_table);
             unsuc_trials++;
         } else {
             // this should be very rare
-            assert(*(int *)dp == key);
+            assert(value == key);
         }
     }
     end = clock();
@@ -1283,21 +1982,24 @@ void equilibriumDriver(void)
 }
 
 /* build a table with random keys.  The keys are generated with a uniform
- * distribution.  
+ * distribution.  num_addr must be less than table_size unless the table
+ * resizes itself.
  */
 int build_random(table_t *T, int table_size, int num_addr)
 {
     hashkey_t key;
     int i, range, code;
     int probes = 0;
-    int *ip;
     range = MAXID - MINID + 1;
+    if (num_addr >= table_size && !(TableMode & TABLE_AUTORESIZE)) {
+        printf("build of random table needs (%d) keys in a table of size (%d)\n",
+                num_addr, table_size);
+        exit(2);
+    }
     for (i = 0; i < num_addr; i++) {
         key = (hashkey_t) (drand48() * range) + MINID;
         assert(MINID <= key && key <= MAXID);
-        ip = (int *) malloc(sizeof(int));
-        *ip = key;
-        code = table_insert(T, key, ip);
+        code = insertInt(T, key, key);
         if (code == 1) {
             i--;   // since does not increase size of table
             // replaced.  The chances should be very small
@@ -1323,7 +2025,6 @@ int build_seq(table_t *T, int table_size, int num_addr)
 {
     hashkey_t key;
     int i, range, starting, code;
-    int *ip;
     int probes = 0;
     range = MAXID - MINID + 1;
     starting = (int) (drand48() * range) + MINID;
@@ -1332,9 +2033,7 @@ int build_seq(table_t *T, int table_size, int num_addr)
     for (i = starting; i < starting + num_addr; i++) {
         assert(MINID <= i && i <= MAXID);
         key = i;
-        ip = (int *) malloc(sizeof(int));
-        *ip = i;
-        code = table_insert(T, key, ip);
+        code = insertInt(T, key, i);
         if (code != 0) {
             printf("build of sequential table failed code (%d) index (%d) key (%d)\n",
                     code, i - starting, key);
@@ -1353,7 +2052,6 @@ int build_fold(table_t *T, int table_size, int num_addr)
 {
     int i, range, starting, code;
     int probes = 0;
-    int *ip;
     range = MAXID - MINID + 1;
     starting = (int) (drand48() * range) + MINID;
     if (starting <= MINID + table_size)
@@ -1362,9 +2060,7 @@ int build_fold(table_t *T, int table_size, int num_addr)
         starting -= table_size;
     for (i = starting; i > starting - num_addr/2; i--) {
         assert(MINID <= i && i <= MAXID);
-        ip = (int *) malloc(sizeof(int));
-        *ip = i;
-        code = table_insert(T, i, ip);
+        code = insertInt(T, i, i);
         if (code != 0) {
             printf("build of first phase of folded table failed code (%d) index (%d) key (%d)\n",
                     code, i - starting, i);
@@ -1374,9 +2070,7 @@ int build_fold(table_t *T, int table_size, int num_addr)
     }
     for (i = starting + table_size; i > starting + table_size - (num_addr+1)/2; i--) {
         assert(MINID <= i && i <= MAXID);
-        ip = (int *) malloc(sizeof(int));
-        *ip = i;
-        code = table_insert(T, i, ip);
+        code = insertInt(T, i, i);
         if (code != 0) {
             printf("build of second phase of folded table failed code (%d) index (%d) key (%d)\n",
                     code, i - starting, i);
@@ -1396,12 +2090,9 @@ int build_worst(table_t *T, int table_size, int num_addr)
     hashkey_t key = MAXID;
     int i, batches = 0, code;
     int probes = 0;
-    int *ip;
     for (i = 0; i < num_addr; i++) {
         assert(MINID <= key && key <= MAXID);
-        ip = (int *) malloc(sizeof(int));
-        *ip = key;
-        code = table_insert(T, key, ip);
+        code = insertInt(T, key, key);
         if (code != 0) {
             printf("build of worst table failed: code (%d) index (%d) key (%d) batch (%d)\n",
                     code, i, key, batches);
@@ -1419,6 +2110,100 @@ int build_worst(table_t *T, int table_size, int num_addr)
     return probes;
 }
 
+/* build the same table as build_random, build_seq, build_fold, or
+ * build_worst (picked with -i), but insert all the keys with one call to
+ * table_build_from_array using -j threads.  The keys are generated in the
+ * same order as the one-at-a-time builders.  A random key that turns out to
+ * be a duplicate is replaced by more random keys inserted one at a time, as
+ * in build_random, so the final set of keys is the same.
+ */
+int build_bulk(table_t *T, int table_size, int num_addr)
+{
+    hashkey_t key;
+    int i, range, starting, batches = 0, code;
+    int probes;
+    hashkey_t *keys = (hashkey_t *) malloc(num_addr * sizeof(hashkey_t));
+    data_t *data = (data_t *) malloc(num_addr * sizeof(data_t));
+    clock_t start, end;
+    struct timespec wall_start, wall_end;
+
+    range = MAXID - MINID + 1;
+    if (TableType == RAND) {
+        printf(" %d random keys", num_addr);
+        for (i = 0; i < num_addr; i++)
+            keys[i] = (hashkey_t) (drand48() * range) + MINID;
+    } else if (TableType == SEQ) {
+        printf(" %d sequential keys", num_addr);
+        starting = (int) (drand48() * range) + MINID;
+        if (starting >= MAXID - table_size)
+            starting -= table_size;
+        for (i = 0; i < num_addr; i++)
+            keys[i] = starting + i;
+    } else if (TableType == FOLD) {
+        printf(" %d folded keys", num_addr);
+        starting = (int) (drand48() * range) + MINID;
+        if (starting <= MINID + table_size)
+            starting += table_size;
+        if (starting >= MAXID - table_size)
+            starting -= table_size;
+        for (i = 0; i < num_addr/2; i++)
+            keys[i] = starting - i;
+        for (i = 0; i < (num_addr+1)/2; i++)
+            keys[num_addr/2 + i] = starting + table_size - i;
+    } else if (TableType == WORST) {
+        printf(" %d worst keys", num_addr);
+        key = MAXID;
+        for (i = 0; i < num_addr; i++) {
+            keys[i] = key;
+            if (key < MINID + table_size) {
+                batches++;
+                printf("batch %d\n", batches);
+                key = MAXID - batches;
+            }
+            else
+                key -= table_size;
+        }
+    } else {
+        printf("invalid option for table type\n");
+        exit(7);
+    }
+    printf(", bulk load with %d threads\n", BulkThreads);
+    for (i = 0; i < num_addr; i++) {
+        assert(MINID <= keys[i] && keys[i] <= MAXID);
+        data[i] = newInt(T, keys[i]);
+    }
+
+    start = clock();
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    code = table_build_from_array(T, keys, data, num_addr, BulkThreads);
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    end = clock();
+    if (code != 0) {
+        printf("bulk build of table failed code (%d)\n", code);
+        exit(2);
+    }
+    printf("    Bulk load time=%g, cpu time=%g\n",
+            1000*(wall_end.tv_sec - wall_start.tv_sec)
+            + (wall_end.tv_nsec - wall_start.tv_nsec)/1e6,
+            1000*((double)(end-start))/CLOCKS_PER_SEC);
+    probes = table_stats(T);
+
+    /* top up random keys that replaced an earlier copy */
+    while (table_entries(T) < num_addr) {
+        assert(TableType == RAND);
+        key = (hashkey_t) (drand48() * range) + MINID;
+        code = insertInt(T, key, key);
+        if (code != 0 && code != 1) {
+            printf("build of random table failed code (%d) key (%d)\n", code, key);
+            exit(2);
+        }
+        probes += table_stats(T);
+    }
+    free(keys);
+    free(data);
+    return probes;
+}
+
 /* return first prime number at number or greater
  *
  * There is at least one prime p such that n < p < 2n
@@ -1478,6 +2263,34 @@ void performanceFormulas(double load_factor)
             printf("    Expected probes for unsuccessful search %g\n",
                     1.0/(1.0 - load_factor) - load_factor - log(1.0 - load_factor));
         }
+        else if (ProbeDec == ROBIN_HOOD) {
+            // Same total displacement as linear probing.  An unsuccessful
+            // search stops after the keys that probed past its home slot, and
+            // a slot is passed by load_factor * (successful search) keys on
+            // average.
+            double suc = 0.5 * (1.0 + 1.0/(1.0 - load_factor));
+            printf("--- Robin Hood probe sequence performance formulas ---\n");
+            printf("    Expected probes for successful search %g\n", suc);
+            printf("    Expected probes for unsuccessful search %g\n",
+                    1.0 + load_factor * suc);
+        }
+        else if (ProbeDec == CUCKOO) {
+            // a search looks at all 4 candidate slots unless it finds the
+            // key first, then at the keys in the stash
+            printf("--- Cuckoo hashing bounds ---\n");
+            printf("    Most probes for successful search 8\n");
+            printf("    Probes for unsuccessful search 4 plus the keys in the stash\n");
+        }
+        else if (ProbeDec == HOPSCOTCH) {
+            // only keys with the same home are compared.  That count is
+            // Poisson with mean load_factor, and a search with none counts
+            // as one probe.
+            printf("--- Hopscotch performance formulas ---\n");
+            printf("    Expected probes for successful search %g\n",
+                    1.0 + load_factor/2.0);
+            printf("    Expected probes for unsuccessful search %g\n",
+                    load_factor + exp(-load_factor));
+        }
     }
     else if (TableType == SEQ) {
         if (HashAlg == ABS_HASH && ProbeDec == LINEAR) {
@@ -1525,12 +2338,18 @@ void getCommandLine(int argc, char **argv)
     int c;
     int index;
 
-    while ((c = getopt(argc, argv, "m:a:h:f:i:t:s:p:qerbdv")) != -1)
+    while ((c = getopt(argc, argv, "m:a:h:f:i:t:s:p:o:x:l:j:c:k:g:qerbdvz")) != -1)
         switch(c) {
             case 'm': TableSize = atoi(optarg);      break;
             case 'a': LoadFactor = atof(optarg);     break;
             case 's': Seed = atoi(optarg);           break;
             case 't': Trials = atoi(optarg);         break;
+            case 'l': BatchSize = atoi(optarg);      break;
+            case 'j': BulkThreads = atoi(optarg);    break;
+            case 'c': MaxThreads = atoi(optarg);     break;
+            case 'k': ShardBits = atoi(optarg);      break;
+            case 'g': RehashThreads = atoi(optarg);  break;
+            case 'z': CompactTest = TRUE;            break;
             case 'v': Verbose = TRUE;                break;
             case 'e': EquilibriumTest = TRUE;        break;
             case 'r': RetrieveTest = TRUE;           break;
@@ -1545,9 +2364,40 @@ void getCommandLine(int argc, char **argv)
                           ProbeDec = DOUBLE;
                       else if (strcmp(optarg, "quad") == 0)
                           ProbeDec = QUAD;
+                      else if (strcmp(optarg, "robin") == 0)
+                          ProbeDec = ROBIN_HOOD;
+                      else if (strcmp(optarg, "cuckoo") == 0)
+                          ProbeDec = CUCKOO;
+                      else if (strcmp(optarg, "hop") == 0)
+                          ProbeDec = HOPSCOTCH;
                       else {
                           fprintf(stderr, "invalid type of probing decrement: %s\n", optarg);
-                          fprintf(stderr, "must be {linear | double | quad}\n");
+                          fprintf(stderr, "must be {linear | double | quad | robin | cuckoo | hop}\n");
+                          exit(1);
+                      }
+                      break;
+            case 'o':
+                      if (strcmp(optarg, "ctrl") == 0)
+                          TableMode |= TABLE_CTRL;
+                      else if (strcmp(optarg, "soa") == 0)
+                          TableMode |= TABLE_SOA;
+                      else if (strcmp(optarg, "bshift") == 0)
+                          TableMode |= TABLE_BSHIFT;
+                      else if (strcmp(optarg, "auto") == 0)
+                          TableMode |= TABLE_AUTORESIZE;
+                      else if (strcmp(optarg, "lockfree") == 0)
+                          TableMode |= TABLE_LOCKFREE;
+                      else if (strcmp(optarg, "inline") == 0)
+                          TableMode |= TABLE_INLINE;
+                      else if (strcmp(optarg, "pool") == 0)
+                          TableMode |= TABLE_POOL;
+                      else if (strcmp(optarg, "hashes") == 0)
+                          TableMode |= TABLE_HASHES;
+                      else if (strcmp(optarg, "reseed") == 0)
+                          TableMode |= TABLE_RESEED;
+                      else {
+                          fprintf(stderr, "invalid table mode: %s\n", optarg);
+                          fprintf(stderr, "must be {ctrl | soa | bshift | auto | lockfree | inline | pool | hashes | reseed}\n");
                           exit(1);
                       }
                       break;
@@ -1570,9 +2420,28 @@ void getCommandLine(int argc, char **argv)
                           HashAlg = ELF_HASH;
                       else if (strcmp(optarg, "tab") == 0)
                           HashAlg = TAB_HASH;
+                      else if (strcmp(optarg, "mur") == 0)
+                          HashAlg = MUR_HASH;
+                      else if (strcmp(optarg, "mxs") == 0)
+                          HashAlg = MXS_HASH;
+                      else if (strcmp(optarg, "crc") == 0)
+                          HashAlg = CRC_HASH;
+                      else if (strcmp(optarg, "twt") == 0)
+                          HashAlg = TWT_HASH;
                       else {
                           fprintf(stderr, "invalid Hash Algorithm : %s\n", optarg);
-                          fprintf(stderr, "must be: -f abs|djb|sax|fnv|oat|jen|jsw|elf|tab\n");
+                          fprintf(stderr, "must be: -f abs|djb|sax|fnv|oat|jen|jsw|elf|tab|mur|mxs|crc|twt\n");
+                          exit(1);
+                      }
+                      break;
+            case 'x':
+                      if (strcmp(optarg, "mod") == 0)
+                          HashReduce = REDUCE_MOD;
+                      else if (strcmp(optarg, "fast") == 0)
+                          HashReduce = REDUCE_FAST;
+                      else {
+                          fprintf(stderr, "invalid position reduction: %s\n", optarg);
+                          fprintf(stderr, "must be {mod | fast}\n");
                           exit(1);
                       }
                       break;
@@ -1601,25 +2470,48 @@ void getCommandLine(int argc, char **argv)
                       printf("General options ---------\n");
                       printf("  -m 11     table size\n");
                       printf("  -a 0.9    load factor\n");
-                      printf("  -h linear|double|quad\n");
+                      printf("  -h linear|double|quad|robin|cuckoo|hop\n");
                       printf("            Type of probing decrement\n");
+                      printf("  -o ctrl|soa|bshift|auto|lockfree|inline|pool|hashes|reseed\n");
+                      printf("            table mode, repeat -o for more than one\n");
                       printf("  -r        run retrieve test driver \n");
                       printf("  -d        run deletion test drivers\n");
                       printf("  -b        run basic test driver \n");
                       printf("  -p x      run Two Sums Problem driver for x=1,2,3, or 4\n");
                       printf("                 use -m array size -t test trials\n");
                       printf("  -e        run equilibrium test driver\n");
+                      printf("  -c 4      run threaded equilibrium driver with 1 to 4 threads\n");
+                      printf("  -k 3      with -c, share 2^3 locked shards instead of one table\n");
                       printf("  -i rand|seq|fold|worst\n");
                       printf("            type of keys for retrieve test driver \n");
-                      printf("  -f abs|djb|sax|fnv|oat|jen|jsw|elf|tab\n");
+                      printf("  -j 4      build the -r and -e tables with table_build_from_array\n");
+                      printf("            using 4 threads\n");
+                      printf("  -g 4      rehash the -e table with table_rehash_threads using 4 threads\n");
+                      printf("  -z        clear the -e table's deleted markers with table_compact\n");
+                      printf("  -f abs|djb|sax|fnv|oat|jen|jsw|elf|tab|mur|mxs|crc|twt\n");
+                      printf("  -x mod|fast\n");
+                      printf("            reduce hashes to positions with mod or multiply-shift\n");
                       printf("\nOptions for test driver ---------\n");
                       printf("  -t 50000  number of trials in drivers\n");
+                      printf("  -l 64     with -r or -e, also time lookups in batches of 64\n");
                       printf("  -v        turn on verbose prints (default off)\n");
                       printf("  -s 26214  seed for random number generator\n");
                       exit(1);
         }
     for (index = optind; index < argc; index++)
         printf("Non-option argument %s\n", argv[index]);
+    if ((TableMode & TABLE_INLINE) && (DeletionTest || RehashTest || SpecialTest || MaxThreads > 0)) {
+        printf("-o inline works with the -r, -e, and -p drivers only\n");
+        exit(1);
+    }
+    if ((TableMode & TABLE_POOL) && (DeletionTest || RehashTest || SpecialTest || MaxThreads > 0)) {
+        printf("-o pool works with the -r, -e, and -p drivers only\n");
+        exit(1);
+    }
+    if ((TableMode & TABLE_RESEED) && (DeletionTest || RehashTest || SpecialTest)) {
+        printf("-o reseed moves keys away from the positions the -d, -b, and -q drivers check\n");
+        exit(1);
+    }
 }
 
 /* vi:set ts=8 sts=4 sw=4 et: */
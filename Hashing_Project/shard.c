@@ -0,0 +1,252 @@
+/*
+ * Drew Buley
+ * C20407096
+ * 12/05/2024
+ * MP6
+ *
+ * Purpose: A sharded front end for the hash table ADT in table.c.  Keys are
+ *          split over 2^k independent tables so threads working on
+ *          different shards never wait on each other, and each shard
+ *          rehashes on its own schedule.
+ *
+ * Assumptions: the shards are only used through these functions while the
+ *              container is shared by threads
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "table.h"
+#include "shard.h"
+
+/* A shard is rehashed once its keys plus deleted markers could fill
+ * SHARD_MAX_USED of its cells.  It doubles if more than SHARD_GROW_LOAD of
+ * the cells hold keys, and is only cleared of deleted markers otherwise.
+ */
+#define SHARD_MAX_USED  0.8
+#define SHARD_GROW_LOAD 0.5
+#define SHARD_MAX_BITS  16
+
+static __thread int shard_probes;
+
+/* The shard is picked from the high bits of a full-avalanche mix of the key
+ * (the murmur3 finalizer of the key xor a constant).  It must not share bits
+ * with the tables' own hash: with -x fast the home slot also comes from the
+ * high bits of the hash, so routing by the same bits would put all the keys
+ * of a shard into 1/2^k of its slots.  For the same reason it does not use
+ * the multiplier of the TABLE_CTRL tags, and the constant keeps it apart
+ * from mur_hash, which is the plain finalizer.
+ */
+static inline int shard_route(const shard_t *S, hashkey_t K)
+{
+    unsigned h = (unsigned) K ^ 0x5bd1e995u;
+    if (S->shard_bits == 0) {
+        return 0;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h >> (32 - S->shard_bits);
+}
+
+/* return first prime number at number or greater */
+static int shard_next_prime(int number)
+{
+    if (number <= 2) {
+        return 2;
+    }
+    if (number % 2 == 0) {
+        number++;
+    }
+    for (int i = 3; i * i <= number; i += 2) {
+        if (number % i == 0) {
+            number += 2; //only test odds
+            i = 1;
+        }
+    }
+    return number;
+}
+
+/* This function creates the shards and their locks
+ *
+ * Inputs: shard_bits - k, there are 2^k shards
+ *         shard_size, probe_type, mode - for each shard's table, see
+ *         table_construct_mode
+ *
+ * Outputs: pointer to the sharded container
+ */
+shard_t *shard_construct(int shard_bits, int shard_size, int probe_type, int mode)
+{
+    if (shard_bits < 0 || shard_bits > SHARD_MAX_BITS) {
+        printf("Number of shard bits must be 0 to %d, you entered: %d\n",
+                SHARD_MAX_BITS, shard_bits);
+        exit(1);
+    }
+    if (mode & (TABLE_LOCKED | TABLE_LOCKFREE)) {
+        printf("Shards are locked by the container, do not use TABLE_LOCKED or TABLE_LOCKFREE\n");
+        exit(1);
+    }
+    shard_t *S = (shard_t *)malloc(sizeof(shard_t));
+    S->shard_bits = shard_bits;
+    S->num_shards = 1 << shard_bits;
+    S->shards = (shard_slot_t *)aligned_alloc(64, S->num_shards * sizeof(shard_slot_t));
+    for (int i = 0; i < S->num_shards; i++) {
+        pthread_mutex_init(&S->shards[i].lock, NULL);
+        S->shards[i].table = table_construct_mode(shard_size, probe_type, mode);
+        S->shards[i].num_keys = 0;
+        S->shards[i].used = 0;
+        S->shards[i].rehashes = 0;
+    }
+    return S;
+}
+
+/* Rehash a shard that is close to running out of empty cells.  The caller
+ * holds the shard's lock.
+ */
+static void shard_maintain(shard_slot_t *slot)
+{
+    table_t *T = slot->table;
+    if (slot->used <= SHARD_MAX_USED * T->table_size) {
+        return;
+    }
+    int num_keys = table_entries(T);
+    int new_size = T->table_size;
+    if (num_keys > SHARD_GROW_LOAD * T->table_size) {
+        new_size = 2 * T->table_size;
+        if (T->type_of_probing == DOUBLE) {
+            new_size = shard_next_prime(new_size);
+        }
+    }
+    slot->table = table_rehash(T, new_size);
+    slot->used = num_keys;
+    slot->rehashes++;
+}
+
+/* Insert (K, I) into the shard for K
+ * Inputs: pointer to the container, key, and data
+ * Outputs: same as table_insert
+ */
+int shard_insert(shard_t *S, hashkey_t K, data_t I)
+{
+    shard_slot_t *slot = &S->shards[shard_route(S, K)];
+    pthread_mutex_lock(&slot->lock);
+    int code = table_insert(slot->table, K, I);
+    shard_probes = table_stats(slot->table);
+    if (code == 0) {
+        __atomic_store_n(&slot->num_keys, slot->num_keys + 1, __ATOMIC_RELAXED);
+        //a new key may have used an empty cell
+        slot->used++;
+        shard_maintain(slot);
+    }
+    pthread_mutex_unlock(&slot->lock);
+    return code;
+}
+
+/* Remove K from its shard
+ * Inputs: pointer to the container, key
+ * Outputs: same as table_delete
+ */
+data_t shard_delete(shard_t *S, hashkey_t K)
+{
+    shard_slot_t *slot = &S->shards[shard_route(S, K)];
+    pthread_mutex_lock(&slot->lock);
+    data_t I = table_delete(slot->table, K);
+    shard_probes = table_stats(slot->table);
+    if (I != NULL) {
+        __atomic_store_n(&slot->num_keys, slot->num_keys - 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&slot->lock);
+    return I;
+}
+
+/* Look up K in its shard
+ * Inputs: pointer to the container, key
+ * Outputs: same as table_retrieve
+ */
+data_t shard_retrieve(shard_t *S, hashkey_t K)
+{
+    shard_slot_t *slot = &S->shards[shard_route(S, K)];
+    pthread_mutex_lock(&slot->lock);
+    data_t I = table_retrieve(slot->table, K);
+    shard_probes = table_stats(slot->table);
+    pthread_mutex_unlock(&slot->lock);
+    return I;
+}
+
+/* Returns the number of keys in all shards, without taking their locks
+ * Inputs: pointer to the container
+ * Outputs: total number of keys
+ */
+int shard_entries(shard_t *S)
+{
+    int total = 0;
+    for (int i = 0; i < S->num_shards; i++) {
+        total += __atomic_load_n(&S->shards[i].num_keys, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/* Probes for the calling thread's last shard_insert, shard_delete, or
+ * shard_retrieve, kept in the thread-local shard_probes.  S is not used; it
+ * is there to match table_stats.
+ * Inputs: pointer to the container
+ * Outputs: number of probes
+ */
+int shard_stats(shard_t *S)
+{
+    return shard_probes;
+}
+
+/* Finds the shard that holds K
+ * Inputs: pointer to the container, key
+ * Outputs: index of the shard
+ */
+int shard_of(shard_t *S, hashkey_t K)
+{
+    return shard_route(S, K);
+}
+
+/* Prints the load of each shard
+ * Inputs: pointer to the container
+ * Outputs: none, directly prints in terminal
+ */
+void shard_print_load(shard_t *S)
+{
+    int total = 0, max_keys = 0;
+    printf("  shard\tsize\tkeys\tload\trehashes\n");
+    for (int i = 0; i < S->num_shards; i++) {
+        shard_slot_t *slot = &S->shards[i];
+        pthread_mutex_lock(&slot->lock);
+        int size = slot->table->table_size;
+        int keys = table_entries(slot->table);
+        int rehashes = slot->rehashes;
+        pthread_mutex_unlock(&slot->lock);
+        printf("  %d\t%d\t%d\t%.3f\t%d\n", i, size, keys, (double) keys / size, rehashes);
+        total += keys;
+        if (keys > max_keys) {
+            max_keys = keys;
+        }
+    }
+    double mean = (double) total / S->num_shards;
+    printf("  keys per shard: mean %.1f, max %d (%.1f%% above mean)\n", mean, max_keys,
+            mean > 0 ? 100.0 * (max_keys - mean) / mean : 0.0);
+}
+
+/* This function frees every shard, the data stored in them, and the container
+ * Inputs: pointer to the container
+ * Outputs: None
+ */
+void shard_destruct(shard_t *S)
+{
+    for (int i = 0; i < S->num_shards; i++) {
+        table_destruct(S->shards[i].table);
+        pthread_mutex_destroy(&S->shards[i].lock);
+    }
+    free(S->shards);
+    free(S);
+}
@@ -0,0 +1,71 @@
+/* shard.h
+ * Lab6: Hash Tables
+ * ECE 2230, Fall 2024
+ * Drew Buley
+ * C20407096
+ * 12/5/2024
+ *
+ * A sharded table: 2^k independent table_t shards, each with its own lock.
+ * Include table.h before this file.
+ */
+
+/* One shard.  Each is a full cache line so threads working in different
+ * shards never write to the same line.
+ */
+typedef struct shard_slot_tag {
+    pthread_mutex_t lock;
+    table_t *table;
+    int num_keys;   /* table_entries(table), also read without the lock */
+    int used;       /* upper bound on the cells that are not empty */
+    int rehashes;   /* rehashes of this shard so far */
+} __attribute__((aligned(64))) shard_slot_t;
+
+typedef struct shard_tag {
+    int shard_bits;         /* k */
+    int num_shards;         /* 2^k */
+    shard_slot_t *shards;
+} shard_t;
+
+/* Create 2^shard_bits empty shards, each a table_construct_mode(shard_size,
+ * probe_type, mode) table.  shard_bits must be 0 to 16, and mode must not
+ * include TABLE_LOCKED or TABLE_LOCKFREE since each shard already has its
+ * own lock.
+ *
+ * A key goes to the shard picked by the high bits of a mix of the key that
+ * is independent of the tables' own hash.  Each shard rehashes itself, while
+ * holding only its own lock, when its deleted markers and keys fill most of
+ * its cells: to twice the size if it is more than half full, and to the same
+ * size (removing the deleted markers) otherwise.  So a rehash only stalls
+ * the keys of one shard.
+ */
+shard_t *shard_construct(int shard_bits, int shard_size, int probe_type, int mode);
+
+/* Same as table_insert, table_delete, and table_retrieve, and may be called
+ * from many threads at once.  As with TABLE_LOCKED, data replaced by
+ * shard_insert is freed at once, so a thread must not use data it retrieved
+ * while another thread may replace or delete that key.
+ */
+int shard_insert(shard_t *S, hashkey_t K, data_t I);
+data_t shard_delete(shard_t *S, hashkey_t K);
+data_t shard_retrieve(shard_t *S, hashkey_t K);
+
+/* returns number of entries in all shards.  The shards are not locked, so
+ * while other threads are changing them the total is approximate.
+ */
+int shard_entries(shard_t *S);
+
+/* The number of probes for the calling thread's most recent call to
+ * shard_insert, shard_delete, or shard_retrieve
+ */
+int shard_stats(shard_t *S);
+
+/* returns the shard that holds K */
+int shard_of(shard_t *S, hashkey_t K);
+
+/* Print the size, keys, load factor, and rehash count of each shard, and how
+ * far the shard with the most keys is above the average.
+ */
+void shard_print_load(shard_t *S);
+
+/* Free all shards and the data stored in them */
+void shard_destruct(shard_t *S);
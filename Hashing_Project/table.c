@@ -23,12 +23,468 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <math.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <time.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "table.h"
 #include "hashes.h"
+#include "hashes_inline.h"
 #define empty (INT_MAX-1)
 #define deleted (INT_MIN+1)
 
+/* Control bytes for TABLE_CTRL.  A full slot holds a 7-bit tag taken from a
+ * multiplicative hash of its key, so a tag mismatch rejects a slot without
+ * loading the key.  The bytes before ctrl[0] mirror the last CTRL_GROUP-1
+ * slots so a group that wraps below index 0 is still a single load.
+ */
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+
+#if defined(__AVX2__)
+#define CTRL_GROUP 32
+typedef __m256i ctrl_group_t;
+#define ctrl_load(p)  _mm256_loadu_si256((const __m256i *) (p))
+#define ctrl_eq(g, c) ((unsigned) _mm256_movemask_epi8( \
+            _mm256_cmpeq_epi8((g), _mm256_set1_epi8((char) (c)))))
+#elif defined(__SSE2__)
+#define CTRL_GROUP 16
+typedef __m128i ctrl_group_t;
+#define ctrl_load(p)  _mm_loadu_si128((const __m128i *) (p))
+#define ctrl_eq(g, c) ((unsigned) _mm_movemask_epi8( \
+            _mm_cmpeq_epi8((g), _mm_set1_epi8((char) (c)))))
+#else
+#define CTRL_GROUP 16
+typedef const unsigned char *ctrl_group_t;
+#define ctrl_load(p)  (p)
+static inline unsigned ctrl_eq(ctrl_group_t g, unsigned char c)
+{
+    unsigned mask = 0;
+    for (int b = 0; b < CTRL_GROUP; b++) {
+        if (g[b] == c) {
+            mask |= 1u << b;
+        }
+    }
+    return mask;
+}
+#endif
+#define CTRL_ALL ((unsigned) (((unsigned long long) 1 << CTRL_GROUP) - 1))
+
+static inline unsigned char ctrl_tag(hashkey_t K)
+{
+    return ((unsigned) K * 0x9e3779b1u) >> 25;
+}
+
+/* index of the highest set bit, which is the earliest slot in a group since
+ * the probe decrements
+ */
+static inline int ctrl_high(unsigned mask)
+{
+    return 31 - __builtin_clz(mask);
+}
+
+static inline void ctrl_set(table_t *T, int index, unsigned char c)
+{
+    T->ctrl[index] = c;
+    if (index > T->table_size - CTRL_GROUP && T->table_size >= CTRL_GROUP) {
+        T->ctrl[index - T->table_size] = c;
+    }
+}
+
+/* Slot helpers.  Every access to a slot goes through these so the same code
+ * works with either layout (oa or keys/data), and every write goes through
+ * slot_put or slot_mark so the optional per-slot arrays stay in step.
+ */
+static inline hashkey_t slot_key(const table_t *T, int index)
+{
+    if (T->keys != NULL) {
+        return T->keys[index];
+    }
+    return T->oa[index].key;
+}
+
+static inline data_t slot_data(const table_t *T, int index)
+{
+    if (T->data != NULL) {
+        return T->data[index];
+    }
+    return T->oa[index].data_ptr;
+}
+
+/* Full hash of K with algorithm alg, mixed with the seed of a TABLE_RESEED
+ * table first.  Every hash of a key in this file goes through here.
+ */
+static inline __attribute__((always_inline)) unsigned table_hash_as(const table_t *T,
+        hashkey_t K, int alg)
+{
+    if (T->key_seed != 0) {
+        K = hashes_seed_key(K, T->key_seed);
+    }
+    return hashes_hash_alg(alg, K);
+}
+
+static inline unsigned table_hash(const table_t *T, hashkey_t K)
+{
+    return table_hash_as(T, K, T->hash_alg);
+}
+
+/* table_hash of n keys, with hashes_hash_batch unless the keys are seeded */
+static void table_hash_batch(const table_t *T, const hashkey_t *keys, int n, unsigned *out)
+{
+    if (T->key_seed == 0) {
+        hashes_hash_batch(T->hash_alg, keys, n, out);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = table_hash(T, keys[i]);
+    }
+}
+
+/* Full hash of K to store with it in a TABLE_HASHES table, 0 if the table
+ * stores none
+ */
+static inline unsigned key_hash(const table_t *T, hashkey_t K)
+{
+    if (T->hashes == NULL) {
+        return 0;
+    }
+    return table_hash(T, K);
+}
+
+/* Full hash of the key at index, stored or computed */
+static inline unsigned slot_hash(const table_t *T, int index)
+{
+    if (T->hashes != NULL) {
+        return T->hashes[index];
+    }
+    return table_hash(T, slot_key(T, index));
+}
+
+/* h is the full hash of K, which only a TABLE_HASHES table keeps */
+static inline void slot_put_hash(table_t *T, int index, hashkey_t K, data_t I, unsigned h)
+{
+    if (T->keys != NULL) {
+        T->keys[index] = K;
+        T->data[index] = I;
+    } else {
+        T->oa[index].key = K;
+        T->oa[index].data_ptr = I;
+    }
+    if (T->ctrl != NULL) {
+        ctrl_set(T, index, ctrl_tag(K));
+    }
+    if (T->hashes != NULL) {
+        T->hashes[index] = h;
+    }
+}
+
+static inline void slot_put(table_t *T, int index, hashkey_t K, data_t I)
+{
+    slot_put_hash(T, index, K, I, key_hash(T, K));
+}
+
+/* Copy the key at from, with its data and stored hash, into the slot at to */
+static inline void slot_move(table_t *T, int to, int from)
+{
+    slot_put_hash(T, to, slot_key(T, from), slot_data(T, from),
+            T->hashes != NULL ? T->hashes[from] : 0);
+}
+
+/* mark must be empty or deleted.  A TABLE_LOCKFREE table also clears the
+ * data, which a later claim of the slot expects to find NULL.
+ */
+static inline void slot_mark(table_t *T, int index, hashkey_t mark)
+{
+    if (T->keys != NULL) {
+        T->keys[index] = mark;
+    } else {
+        T->oa[index].key = mark;
+    }
+    if (T->mode & TABLE_LOCKFREE) {
+        if (T->data != NULL) {
+            T->data[index] = NULL;
+        } else {
+            T->oa[index].data_ptr = NULL;
+        }
+    }
+    if (T->ctrl != NULL) {
+        ctrl_set(T, index, mark == empty ? CTRL_EMPTY : CTRL_DELETED);
+    }
+}
+
+/* TABLE_POOL slabs.  Each slab is POOL_SLAB_SIZE bytes at an address that
+ * is a multiple of POOL_SLAB_SIZE and holds objects of one size class, so
+ * the class of an object is found from the header at the start of its slab.
+ * Classes are the powers of two from 1 << POOL_MIN_SHIFT to TABLE_POOL_MAX.
+ */
+#define POOL_SLAB_SIZE  (1 << 20)
+#define POOL_MIN_SHIFT  4
+#define POOL_CLASSES    7
+#define POOL_HEADER     64  //objects start one cache line into the slab
+
+typedef struct pool_slab_tag {
+    struct pool_slab_tag *next;
+    int size_class;
+} pool_slab_t;
+
+typedef struct pool_tag {
+    void *free_list[POOL_CLASSES];  /* freed objects, linked through themselves */
+    char *bump[POOL_CLASSES];       /* next never used object of the newest slab */
+    char *bump_end[POOL_CLASSES];
+    pool_slab_t *slabs;             /* every slab, for pool_destroy */
+    int num_slabs;
+} pool_t;
+
+static int pool_class(int size)
+{
+    int c = 0;
+    while ((1 << (c + POOL_MIN_SHIFT)) < size) {
+        c++;
+    }
+    return c;
+}
+
+/* Map a new slab for class c.  mmap only promises page alignment, so map
+ * twice the size and unmap the ends to get a slab aligned to its size.
+ */
+static void pool_grow(pool_t *P, int c)
+{
+    char *base = mmap(NULL, 2 * POOL_SLAB_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(base != MAP_FAILED);
+    uintptr_t start = ((uintptr_t) base + POOL_SLAB_SIZE - 1) & ~(uintptr_t) (POOL_SLAB_SIZE - 1);
+    if (start > (uintptr_t) base) {
+        munmap(base, start - (uintptr_t) base);
+    }
+    munmap((char *) start + POOL_SLAB_SIZE, (uintptr_t) base + POOL_SLAB_SIZE - start);
+
+    pool_slab_t *slab = (pool_slab_t *) start;
+    slab->size_class = c;
+    slab->next = P->slabs;
+    P->slabs = slab;
+    P->num_slabs++;
+    P->bump[c] = (char *) start + POOL_HEADER;
+    P->bump_end[c] = (char *) start + POOL_SLAB_SIZE;
+}
+
+static void *pool_alloc(pool_t *P, int size)
+{
+    int c = pool_class(size);
+    void *obj = P->free_list[c];
+    if (obj != NULL) {
+        P->free_list[c] = *(void **) obj;
+        return obj;
+    }
+    int bytes = 1 << (c + POOL_MIN_SHIFT);
+    if (P->bump[c] == NULL || P->bump[c] + bytes > P->bump_end[c]) {
+        pool_grow(P, c);
+    }
+    obj = P->bump[c];
+    P->bump[c] += bytes;
+    return obj;
+}
+
+static void pool_free(pool_t *P, void *obj)
+{
+    pool_slab_t *slab = (pool_slab_t *) ((uintptr_t) obj & ~(uintptr_t) (POOL_SLAB_SIZE - 1));
+    int c = slab->size_class;
+    *(void **) obj = P->free_list[c];
+    P->free_list[c] = obj;
+}
+
+/* Unmap every slab, which frees all objects from the pool at once */
+static void pool_destroy(pool_t *P)
+{
+    while (P->slabs != NULL) {
+        pool_slab_t *next = P->slabs->next;
+        munmap(P->slabs, POOL_SLAB_SIZE);
+        P->slabs = next;
+    }
+    free(P);
+}
+
+/* Free data the table owns.  A TABLE_INLINE table holds values instead of
+ * pointers, so there is nothing to free, and a TABLE_POOL table puts the
+ * data back on its pool's free list.
+ */
+static inline void data_release(const table_t *T, data_t I)
+{
+    if (T->mode & TABLE_POOL) {
+        if (I != NULL) {
+            pool_free(T->pool, I);
+        }
+    } else if (!(T->mode & TABLE_INLINE)) {
+        free(I);
+    }
+}
+
+static inline void slot_release(const table_t *T, int index)
+{
+    data_release(T, slot_data(T, index));
+}
+
+/* A TABLE_LOCKFREE table deletes a key by setting its data to NULL and
+ * leaves the key in place, see lf_delete.
+ */
+static inline int slot_live(const table_t *T, int index)
+{
+    hashkey_t key = slot_key(T, index);
+    if (T->mode & TABLE_LOCKFREE) {
+        return key != empty && slot_data(T, index) != NULL;
+    }
+    return key != empty && key != deleted;
+}
+
+/* the slot held a key that has been deleted */
+static inline int slot_tombstone(const table_t *T, int index)
+{
+    hashkey_t key = slot_key(T, index);
+    if (T->mode & TABLE_LOCKFREE) {
+        return key != empty && slot_data(T, index) == NULL;
+    }
+    return key == deleted;
+}
+
+/* slots guarded by each lock of a TABLE_LOCKED table, a 1KB run of oa */
+#define LOCK_STRIPE_SLOTS 64
+
+/* Per-thread record of a TABLE_LOCKFREE table, one cache line each so
+ * threads entering and leaving epochs do not share lines.  See lf_self.
+ */
+#define LF_MAX_THREADS 64
+
+typedef struct lf_thread_tag {
+    int owner;                  /* lf_thread_no of the thread, 0 if unused */
+    unsigned long announce;     /* epoch the thread is in, 0 if none */
+    data_t *retired;            /* data waiting to be freed, oldest first */
+    unsigned long *retired_epoch;   /* global epoch when each was retired */
+    int num_retired;
+    int max_retired;
+} __attribute__((aligned(64))) lf_thread_t;
+
+static unsigned lf_next_serial;
+
+/* CUCKOO tables: candidate slots per key, stash slots after the end of the
+ * table, evictions tried before a key goes to the stash, and new seeds tried
+ * before an insert gives up.
+ */
+#define CUCKOO_WAYS        4
+#define CUCKOO_STASH       4
+#define CUCKOO_MAX_KICKS   500
+#define CUCKOO_MAX_RESEEDS 16
+
+/* HOPSCOTCH neighborhood, one bit of a hop bitmap per slot, the bit of the
+ * bitmap that marks a home with keys in the stash, and the stash slots
+ * after the end of the table.
+ */
+#define HOP_RANGE   63
+#define HOP_STASHED (1ULL << 63)
+#define HOP_STASH   64
+
+/* Number of cells in the slot arrays, the table plus the CUCKOO or
+ * HOPSCOTCH stash
+ */
+static inline int table_cells(const table_t *table)
+{
+    if (table->type_of_probing == CUCKOO) {
+        return table->table_size + CUCKOO_STASH;
+    } else if (table->type_of_probing == HOPSCOTCH) {
+        return table->table_size + HOP_STASH;
+    }
+    return table->table_size;
+}
+
+/* Allocate the slot arrays for the layout selected by table->mode and mark
+ * every slot empty.
+ * Inputs: pointer to the table header
+ *         number of slots
+ */
+static void table_alloc_slots(table_t *table, int table_size)
+{
+    table->table_size = table_size;
+    table->size_magic = hashes_mod_magic(table_size);
+    table->oa = NULL;
+    table->keys = NULL;
+    table->data = NULL;
+    table->stash_count = 0;
+    int cells = table_cells(table);
+    if (table->mode & TABLE_SOA) {
+        table->keys = (hashkey_t *)malloc(cells * sizeof(hashkey_t));
+        table->data = (data_t *)malloc(cells * sizeof(data_t));
+        for (int i = 0; i < cells; i++) {
+            table->keys[i] = empty;
+        }
+    } else {
+        table->oa = (table_entry_t *)malloc(cells * sizeof(table_entry_t));
+        for (int i = 0; i < cells; i++) {
+            table->oa[i].key = empty;
+        }
+    }
+    if (table->mode & TABLE_LOCKFREE) {
+        //a claimed slot must start with NULL data, see lf_publish
+        for (int i = 0; i < table_size; i++) {
+            if (table->data != NULL) {
+                table->data[i] = NULL;
+            } else {
+                table->oa[i].data_ptr = NULL;
+            }
+        }
+    }
+    table->ctrl = NULL;
+    if (table->mode & TABLE_CTRL) {
+        //leading bytes mirror the end of the table, see ctrl_set
+        unsigned char *base = (unsigned char *)malloc(table_size + CTRL_GROUP - 1);
+        memset(base, CTRL_EMPTY, table_size + CTRL_GROUP - 1);
+        table->ctrl = base + CTRL_GROUP - 1;
+    }
+    table->hashes = NULL;
+    if (table->mode & TABLE_HASHES) {
+        table->hashes = (unsigned *)malloc(cells * sizeof(unsigned));
+    }
+    table->hop = NULL;
+    if (table->type_of_probing == HOPSCOTCH) {
+        table->hop = (unsigned long long *)calloc(table_size, sizeof(unsigned long long));
+    }
+    table->locks = NULL;
+    table->num_locks = 0;
+    if (table->mode & TABLE_LOCKED) {
+        //one lock per LOCK_STRIPE_SLOTS slots, and the table lock at the end
+        table->num_locks = (table_size + LOCK_STRIPE_SLOTS - 1) / LOCK_STRIPE_SLOTS;
+        table->locks = (pthread_rwlock_t *)malloc((table->num_locks + 1)
+                * sizeof(pthread_rwlock_t));
+        for (int i = 0; i <= table->num_locks; i++) {
+            pthread_rwlock_init(&table->locks[i], NULL);
+        }
+    }
+}
+
+/* Free the slot arrays, but not the data stored in them */
+static void table_free_slots(table_t *table)
+{
+    free(table->oa);
+    free(table->keys);
+    free(table->data);
+    free(table->hop);
+    free(table->hashes);
+    if (table->ctrl != NULL) {
+        free(table->ctrl - (CTRL_GROUP - 1));
+    }
+    if (table->locks != NULL) {
+        for (int i = 0; i <= table->num_locks; i++) {
+            pthread_rwlock_destroy(&table->locks[i]);
+        }
+        free(table->locks);
+    }
+}
+
 /* This function creates a table ADT that is used in later functions in this file
  * The header stores information about the ADT that other functions will call on
  * such as the number of keys in the table or number of recent probes used
@@ -40,6 +496,76 @@
  *          table ADT as a member)
  */
 table_t *table_construct(int table_size, int probe_type) 
+{
+    return table_construct_mode(table_size, probe_type, TABLE_PLAIN);
+}
+
+/* Same as table_construct but with optional features enabled through mode.
+ * The table hashes with the algorithm selected by hashes_configure.
+ *
+ * Inputs: table size, probe type - as for table_construct
+ *         mode - TableMode_t flags, see table.h
+ *
+ * Outputs: pointer to the created table header
+ */
+table_t *table_construct_mode(int table_size, int probe_type, int mode)
+{
+    return table_construct_hash(table_size, probe_type, mode, hashes_algorithm());
+}
+
+static void table_bind_find(table_t *table);
+
+#define RESEED_BOUND 64
+
+static unsigned long long seed_state;
+static int seed_fixed;
+
+/* Set the start of the TABLE_RESEED seed sequence, see table.h */
+void table_seed_base(unsigned long long base)
+{
+    seed_state = base;
+    seed_fixed = 1;
+}
+
+/* Next TABLE_RESEED seed: a splitmix64 step of a process-wide counter that
+ * starts from the clock and an address unless table_seed_base set it.
+ * Outputs: a seed, never 0 as 0 means no seed
+ */
+static unsigned table_new_seed(void)
+{
+    if (!seed_fixed) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        seed_state = ((unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec)
+            ^ (unsigned long long) (uintptr_t) &seed_state;
+        seed_fixed = 1;
+    }
+    unsigned seed;
+    do {
+        unsigned long long z = __atomic_add_fetch(&seed_state, 0x9e3779b97f4a7c15ULL,
+                __ATOMIC_RELAXED);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        seed = (unsigned) (z ^ (z >> 31));
+    } while (seed == 0);
+    return seed;
+}
+
+/* Longest insert probe sequence before a TABLE_RESEED table reseeds */
+void table_set_probe_bound(table_t *T, int bound)
+{
+    assert(bound > 0);
+    T->probe_bound = bound;
+}
+
+/* Same as table_construct_mode, with the table's own hash algorithm.
+ *
+ * Inputs: table size, probe type, mode - as for table_construct_mode
+ *         hash_alg - one of Hash_Alg_t, see hashes.h
+ *
+ * Outputs: pointer to the created table header
+ */
+table_t *table_construct_hash(int table_size, int probe_type, int mode, int hash_alg)
 {
     assert(table_size > 0);
     // create new table header
@@ -68,14 +594,73 @@ table_t *table_construct(int table_size, int probe_type)
         }
     }
     */
+    if ((mode & TABLE_BSHIFT) && probe_type != LINEAR) {
+        printf("Backward shift deletion (TABLE_BSHIFT) requires LINEAR probing\n");
+        exit(1);
+    }
+    if ((mode & TABLE_LOCKED) && (probe_type == ROBIN_HOOD || probe_type == CUCKOO
+                || probe_type == HOPSCOTCH || (mode & (TABLE_CTRL | TABLE_BSHIFT | TABLE_AUTORESIZE)))) {
+        printf("TABLE_LOCKED requires LINEAR, DOUBLE, or QUAD probing without\n");
+        printf("TABLE_CTRL, TABLE_BSHIFT, or TABLE_AUTORESIZE\n");
+        exit(1);
+    }
+    if ((mode & TABLE_LOCKFREE) && ((probe_type != LINEAR && probe_type != DOUBLE)
+                || (mode & (TABLE_CTRL | TABLE_BSHIFT | TABLE_AUTORESIZE | TABLE_LOCKED)))) {
+        printf("TABLE_LOCKFREE requires LINEAR or DOUBLE probing without\n");
+        printf("TABLE_CTRL, TABLE_BSHIFT, TABLE_AUTORESIZE, or TABLE_LOCKED\n");
+        exit(1);
+    }
+    if (probe_type == CUCKOO && (mode & (TABLE_CTRL | TABLE_AUTORESIZE | TABLE_HASHES))) {
+        printf("CUCKOO does not support TABLE_CTRL, TABLE_AUTORESIZE, or TABLE_HASHES\n");
+        exit(1);
+    }
+    if ((mode & TABLE_RESEED) && (probe_type == CUCKOO || (mode & (TABLE_LOCKED | TABLE_LOCKFREE)))) {
+        printf("TABLE_RESEED does not support CUCKOO, TABLE_LOCKED, or TABLE_LOCKFREE\n");
+        exit(1);
+    }
+    if ((mode & TABLE_HASHES) && (mode & TABLE_LOCKFREE)) {
+        printf("TABLE_LOCKFREE claims slots by the key alone, do not use TABLE_HASHES\n");
+        exit(1);
+    }
+    if ((mode & TABLE_INLINE) && (mode & TABLE_LOCKFREE)) {
+        printf("TABLE_INLINE values cannot be swapped atomically, do not use TABLE_LOCKFREE\n");
+        exit(1);
+    }
+    if ((mode & TABLE_POOL) && (mode & (TABLE_LOCKED | TABLE_LOCKFREE | TABLE_INLINE))) {
+        printf("TABLE_POOL is for one thread and pointer data, do not use\n");
+        printf("TABLE_LOCKED, TABLE_LOCKFREE, or TABLE_INLINE\n");
+        exit(1);
+    }
+    if (probe_type == HOPSCOTCH && (mode & TABLE_CTRL)) {
+        printf("HOPSCOTCH does not support TABLE_CTRL\n");
+        exit(1);
+    }
+    if (hash_alg < ABS_HASH || hash_alg > TWT_HASH) {
+        printf("Invalid hash algorithm for table: %d\n", hash_alg);
+        exit(1);
+    }
     new_table->num_keys = 0;
     new_table->num_probes = 0;
+    new_table->mode = mode;
+    new_table->hash_alg = hash_alg;
+    new_table->seed = 0;
+    new_table->key_seed = (mode & TABLE_RESEED) ? table_new_seed() : 0;
+    new_table->max_probes = 0;
+    new_table->probe_bound = RESEED_BOUND;
+    new_table->reseeds = 0;
+    table_bind_find(new_table);
 
-    //set table keys to default value
-    new_table->oa = (table_entry_t *)malloc(new_table->table_size * sizeof(table_entry_t));
-    for (int i = 0; i < new_table->table_size; i++) {
-        new_table->oa[i].key = empty;
+    new_table->old = NULL;
+    new_table->migrate_pos = -1;
+    new_table->lf = NULL;
+    new_table->pool = NULL;
+    if (mode & TABLE_LOCKFREE) {
+        new_table->lf = (lf_thread_t *)aligned_alloc(64, LF_MAX_THREADS * sizeof(lf_thread_t));
+        memset(new_table->lf, 0, LF_MAX_THREADS * sizeof(lf_thread_t));
+        new_table->lf_epoch = 1;
+        new_table->lf_serial = __atomic_add_fetch(&lf_next_serial, 1, __ATOMIC_RELAXED);
     }
+    table_alloc_slots(new_table, table_size);
     return new_table;
 }
 
@@ -84,23 +669,1788 @@ table_t *table_construct(int table_size, int probe_type)
  * Inputs: pointer to the table ADT
  * Outputs: integer of the number of keys in the table
  */
-int table_entries(table_t * table) 
+int table_entries(table_t * table) 
+{
+    if (table->old != NULL) {
+        return table->num_keys + table->old->num_keys;
+    }
+    return __atomic_load_n(&table->num_keys, __ATOMIC_RELAXED);
+}
+
+/* This function returns 1 if the table is full and 0 if it is not full
+ * Inputs: pointer to the table
+ * Outputs: 0 or 1 depending on conditional
+ */
+int table_full(table_t * table) 
+{
+    int num_keys = __atomic_load_n(&table->num_keys, __ATOMIC_RELAXED);
+    if (table->table_size - num_keys >= 2) {
+        return 0;
+    } else if (table->table_size - num_keys == 1) {
+        return 1;
+    } else {
+        assert(false); //table is overfull
+    }
+}
+
+/* The _as versions of the probe helpers take the hash algorithm and probe
+ * type as arguments.  The specialized searches (see table_bind_find) pass
+ * constants, so the switches on both fold away and the hash function is
+ * expanded in the probe loop.  The plain versions use the table's own
+ * settings.
+ */
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* Home position of K, reduced without a divide using the table's magic */
+static ALWAYS_INLINE int table_home_as(const table_t *table, hashkey_t K, int alg)
+{
+    return hashes_reduce(table_hash_as(table, K, alg), table->table_size, table->size_magic);
+}
+
+static inline int table_home(const table_t *table, hashkey_t K)
+{
+    return table_home_as(table, K, table->hash_alg);
+}
+
+/* Home positions of n keys, hashed together with hashes_hash_batch */
+static void table_home_batch(const table_t *table, const hashkey_t *keys, int n, int *out)
+{
+    table_hash_batch(table, keys, n, (unsigned *) out);
+    for (int i = 0; i < n; i++) {
+        out[i] = hashes_reduce((unsigned) out[i], table->table_size, table->size_magic);
+    }
+}
+
+/* Home position of the key stored at index.  A TABLE_HASHES table reduces
+ * the stored hash instead of hashing the key again.
+ */
+static ALWAYS_INLINE int slot_home_as(const table_t *table, int index, int alg)
+{
+    if (table->hashes != NULL) {
+        return hashes_reduce(table->hashes[index], table->table_size, table->size_magic);
+    }
+    return table_home_as(table, slot_key(table, index), alg);
+}
+
+static inline int slot_home(const table_t *table, int index)
+{
+    return slot_home_as(table, index, table->hash_alg);
+}
+
+/* Decrement of the first probe for a key with full hash h */
+static ALWAYS_INLINE int probe_dec_as(const table_t *table, unsigned h, int probe)
+{
+    if (probe == LINEAR || probe == ROBIN_HOOD) {
+        return 1;
+    } else if (probe == DOUBLE) {
+        return hashes_dec_inline(h, table->table_size);
+    }
+    assert(probe == QUAD);
+    return 0;
+}
+
+/* Position and decrement of the first probe for K, both from one hash */
+static ALWAYS_INLINE void probe_start_as(const table_t *table, hashkey_t K,
+        int *index, int *prob_dec, int alg, int probe)
+{
+    unsigned h = table_hash_as(table, K, alg);
+    *index = hashes_reduce(h, table->table_size, table->size_magic);
+    *prob_dec = probe_dec_as(table, h, probe);
+}
+
+static inline void probe_start(const table_t *table, hashkey_t K, int *index, int *prob_dec)
+{
+    probe_start_as(table, K, index, prob_dec, table->hash_alg, table->type_of_probing);
+}
+
+/* Same as probe_start when the full hash h of the key is already known */
+static ALWAYS_INLINE void probe_start_hash_as(const table_t *table, unsigned h,
+        int *index, int *prob_dec, int probe)
+{
+    *index = hashes_reduce(h, table->table_size, table->size_magic);
+    *prob_dec = probe_dec_as(table, h, probe);
+}
+
+static inline void probe_start_hash(const table_t *table, unsigned h, int *index, int *prob_dec)
+{
+    probe_start_hash_as(table, h, index, prob_dec, table->type_of_probing);
+}
+
+/* Next position in the probe sequence.  The probe decrements and wraps
+ * around to the end of the table.
+ */
+static ALWAYS_INLINE int probe_next_as(const table_t *table, int index, int *prob_dec, int probe)
+{
+    if (probe == QUAD) {
+        (*prob_dec)++;
+    }
+    index -= *prob_dec;
+    while (index < 0) {
+        index += table->table_size;
+    }
+    return index;
+}
+
+static inline int probe_next(const table_t *table, int index, int *prob_dec)
+{
+    return probe_next_as(table, index, prob_dec, table->type_of_probing);
+}
+
+/* Distance of index from home along the (decrementing) linear probe sequence */
+static inline int probe_dist(const table_t *table, int index, int home)
+{
+    int dist = home - index;
+    if (dist < 0) {
+        dist += table->table_size;
+    }
+    return dist;
+}
+
+/* Linear probe search using the control bytes.  Each step loads the group of
+ * CTRL_GROUP tags ending at index and compares all of them at once against
+ * the tag of K, the empty tag and the deleted tag.  Keys are only read for
+ * tag matches that come before the first empty slot.  num_probes is set to
+ * the count the one-slot-at-a-time search would give.
+ *
+ * Same inputs and outputs as table_find.
+ */
+static int ctrl_find_linear(table_t *table, hashkey_t K, int index, int *stop, int *del)
+{
+    unsigned char tag = ctrl_tag(K);
+    int size = table->table_size;
+    int scanned = 0;
+    *del = -1;
+
+    while (scanned < size) {
+        ctrl_group_t group = ctrl_load(table->ctrl + index - (CTRL_GROUP - 1));
+        unsigned live = CTRL_ALL;
+        if (size - scanned < CTRL_GROUP) {
+            //last group overlaps slots that were already scanned
+            live &= ~0u << (CTRL_GROUP - (size - scanned));
+        }
+        unsigned m_empty = ctrl_eq(group, CTRL_EMPTY) & live;
+        unsigned m_tag = ctrl_eq(group, tag) & live;
+        unsigned m_del = ctrl_eq(group, CTRL_DELETED) & live;
+        if (m_empty != 0) {
+            //ignore everything past the first empty slot
+            unsigned before = ~((2u << ctrl_high(m_empty)) - 1);
+            m_tag &= before;
+            m_del &= before;
+        }
+        while (m_tag != 0) {
+            int b = ctrl_high(m_tag);
+            int slot = index - (CTRL_GROUP - 1 - b);
+            if (slot < 0) {
+                slot += size;
+            }
+            if (slot_key(table, slot) == K) {
+                table->num_probes = scanned + CTRL_GROUP - b;
+                return slot;
+            }
+            m_tag &= ~(1u << b);
+        }
+        if (m_del != 0 && *del == -1) {
+            *del = index - (CTRL_GROUP - 1 - ctrl_high(m_del));
+            if (*del < 0) {
+                *del += size;
+            }
+        }
+        if (m_empty != 0) {
+            int b = ctrl_high(m_empty);
+            *stop = index - (CTRL_GROUP - 1 - b);
+            if (*stop < 0) {
+                *stop += size;
+            }
+            table->num_probes = scanned + CTRL_GROUP - b;
+            return -1;
+        }
+        scanned += CTRL_GROUP;
+        index -= CTRL_GROUP;
+        if (index < 0) {
+            index += size;
+        }
+    }
+    *stop = -1;
+    table->num_probes = size;
+    return -1;
+}
+
+/* Follow the probe sequence for K until K or an empty slot is found, or the
+ * sequence returns to where it started.  Shared by insert, delete, and
+ * retrieve.  Sets num_probes to the number of slots examined.  Called
+ * through table->find, see table_bind_find.
+ *
+ * Inputs: pointer to the table ADT
+ *         key to search for
+ * Outputs: index of K, or -1 if K is not in the table.  When K is not found
+ *          *stop is the empty slot that ended the search (-1 if none) and
+ *          *del is the first slot marked deleted along the way (-1 if none)
+ */
+static ALWAYS_INLINE int table_find_from(table_t *table, hashkey_t K, unsigned h,
+        int *stop, int *del, int probe);
+
+static ALWAYS_INLINE int table_find_as(table_t *table, hashkey_t K, int *stop, int *del,
+        int alg, int probe)
+{
+    return table_find_from(table, K, table_hash_as(table, K, alg), stop, del, probe);
+}
+
+/* table_find_as when the full hash h of K is already known */
+static ALWAYS_INLINE int table_find_from(table_t *table, hashkey_t K, unsigned h,
+        int *stop, int *del, int probe)
+{
+    int index, prob_dec;
+    probe_start_hash_as(table, h, &index, &prob_dec, probe);
+    if (table->ctrl != NULL && probe == LINEAR && table->table_size >= CTRL_GROUP) {
+        return ctrl_find_linear(table, K, index, stop, del);
+    }
+
+    unsigned char tag = ctrl_tag(K);
+    int init_index = index; //used as stop con when table has no empty cells
+    *del = -1;
+    table->num_probes = 1;
+    while (1) {
+        if (table->ctrl != NULL) {
+            unsigned char c = table->ctrl[index];
+            if (c == CTRL_EMPTY) {
+                break;
+            } else if (c == tag && slot_key(table, index) == K) {
+                return index;
+            } else if (c == CTRL_DELETED && *del == -1) {
+                *del = index;
+            }
+        } else {
+            hashkey_t key = slot_key(table, index);
+            if (key == empty) {
+                break;
+            } else if (key == K) {
+                return index;
+            } else if (key == deleted && *del == -1) {
+                *del = index;
+            }
+        }
+        // probe next potential spot
+        index = probe_next_as(table, index, &prob_dec, probe);
+        if (index == init_index) { //checks if next index is where loop started
+            *stop = -1;
+            return -1;
+        }
+        table->num_probes++;
+    }
+    //encountered an empty cell before target key
+    *stop = index;
+    return -1;
+}
+
+/* table_find_as for a table with the oa layout, no control bytes, and no
+ * key seed, which is what a table gets without the optional modes.  The
+ * loop reads oa directly, with no checks of the mode on each probe, so a
+ * plain table searches as fast as it did before the modes were added.
+ */
+static ALWAYS_INLINE int plain_find_from(table_t *table, hashkey_t K, unsigned h,
+        int *stop, int *del, int probe)
+{
+    int size = table->table_size;
+    int index = hashes_reduce(h, size, table->size_magic);
+    int prob_dec = probe_dec_as(table, h, probe);
+    table_entry_t *oa = table->oa;
+    int init_index = index;
+    int first_del = -1;
+    int probes = 1;
+    while (oa[index].key != empty) {
+        if (oa[index].key == K) {
+            table->num_probes = probes;
+            return index;
+        } else if (first_del == -1 && oa[index].key == deleted) {
+            first_del = index;
+        }
+        if (probe == QUAD) {
+            prob_dec++;
+        }
+        index -= prob_dec;
+        while (index < 0) {
+            index += size;
+        }
+        if (index == init_index) {
+            index = -1;
+            break;
+        }
+        probes++;
+    }
+    table->num_probes = probes;
+    *stop = index;
+    *del = first_del;
+    return -1;
+}
+
+/* plain_find_from after hashing K */
+static ALWAYS_INLINE int plain_find_as(table_t *table, hashkey_t K, int *stop, int *del,
+        int alg, int probe)
+{
+    return plain_find_from(table, K, hashes_hash_alg(alg, K), stop, del, probe);
+}
+
+/* Robin Hood probing.  The probe sequence is the same as LINEAR, but an
+ * insert takes over the slot of any key that is closer to its home than the
+ * key being inserted, so every cluster stays sorted by home position.  A
+ * search can stop as soon as it is further from its home than the key in the
+ * current slot, instead of running to the end of the cluster.
+ */
+
+/* Displacement of the key stored at index from its home position */
+static ALWAYS_INLINE int rh_resident_dist_as(const table_t *table, int index, int alg)
+{
+    return probe_dist(table, index, slot_home_as(table, index, alg));
+}
+
+static inline int rh_resident_dist(const table_t *table, int index)
+{
+    return rh_resident_dist_as(table, index, table->hash_alg);
+}
+
+/* Search for K with early termination.
+ *
+ * Inputs: pointer to the table ADT
+ *         key to search for
+ * Outputs: index of K, or -1 if K is not in the table.  When K is not found
+ *          *stop is the slot where K belongs: either empty or holding a key
+ *          closer to its home than K would be, and *stop_dist is the
+ *          distance of that slot from the home of K
+ */
+static ALWAYS_INLINE int rh_find_from(table_t *table, hashkey_t K, int home,
+        int *stop, int *stop_dist, int alg)
+{
+    int index = home;
+    int dist = 0;
+    table->num_probes = 1;
+
+    while (1) {
+        hashkey_t key = slot_key(table, index);
+        if (key == empty) {
+            break;
+        } else if (key == K) {
+            return index;
+        } else if (rh_resident_dist_as(table, index, alg) < dist) {
+            break; //K would have displaced this key, so it is not in the table
+        }
+        index--;
+        if (index < 0) {
+            index += table->table_size;
+        }
+        dist++;
+        table->num_probes++;
+    }
+    *stop = index;
+    *stop_dist = dist;
+    return -1;
+}
+
+/* rh_find_from starting at the home of K */
+static ALWAYS_INLINE int rh_find_as(table_t *table, hashkey_t K, int *stop, int *stop_dist,
+        int alg)
+{
+    return rh_find_from(table, K, table_home_as(table, K, alg), stop, stop_dist, alg);
+}
+
+/* Put K, which is not in the table, at index, dist slots from its home.
+ * The carried key is swapped with any key closer to its home until a cell
+ * is empty.  h is the hash of K for slot_put_hash.
+ */
+static void rh_place(table_t *table, int index, int dist, hashkey_t K, data_t I, unsigned h)
+{
+    while (slot_key(table, index) != empty) {
+        int resident_dist = rh_resident_dist(table, index);
+        if (resident_dist < dist) {
+            hashkey_t tmp_key = slot_key(table, index);
+            data_t tmp_data = slot_data(table, index);
+            unsigned tmp_hash = table->hashes != NULL ? table->hashes[index] : 0;
+            slot_put_hash(table, index, K, I, h);
+            K = tmp_key;
+            I = tmp_data;
+            h = tmp_hash;
+            dist = resident_dist;
+        }
+        index--;
+        if (index < 0) {
+            index += table->table_size;
+        }
+        dist++;
+    }
+    slot_put_hash(table, index, K, I, h);
+    table->num_keys++;
+}
+
+static int rh_insert(table_t *table, hashkey_t K, data_t I)
+{
+    int index, dist;
+    int found = table->find(table, K, &index, &dist);
+    if (found != -1) {
+        slot_release(table, found);
+        slot_put(table, found, K, I);
+        return 1;
+    }
+    if ((table->table_size - table->num_keys) == 1) {
+        return -1;
+    }
+    rh_place(table, index, dist, K, I, key_hash(table, K));
+    return 0;
+}
+
+/* Backward shift deletion.  Every key after the hole that is not in its home
+ * slot moves back one slot, so no deleted markers are needed.
+ */
+static void rh_remove(table_t *table, int index)
+{
+    int next = index - 1;
+    if (next < 0) {
+        next += table->table_size;
+    }
+    while (slot_key(table, next) != empty && rh_resident_dist(table, next) > 0) {
+        slot_move(table, index, next);
+        index = next;
+        next--;
+        if (next < 0) {
+            next += table->table_size;
+        }
+    }
+    slot_mark(table, index, empty);
+}
+
+/* Backward shift deletion for TABLE_BSHIFT.  With plain linear probing the
+ * keys after the hole are not sorted by home, so each one is moved back only
+ * if the hole lies on its probe path between its home and its current slot.
+ * The scan ends at the first empty cell, which ends the cluster.
+ */
+static void bshift_fill(table_t *table, int hole)
+{
+    int next = hole - 1;
+    if (next < 0) {
+        next += table->table_size;
+    }
+    while (slot_key(table, next) != empty) {
+        int home = slot_home(table, next);
+        if (probe_dist(table, hole, home) < probe_dist(table, next, home)) {
+            slot_move(table, hole, next);
+            hole = next;
+        }
+        next--;
+        if (next < 0) {
+            next += table->table_size;
+        }
+    }
+    slot_mark(table, hole, empty);
+}
+
+/* Cuckoo hashing for CUCKOO tables.
+ *
+ * Key K may only be in cells cuckoo_pos(K, 0..CUCKOO_WAYS-1) or in the
+ * stash, cells table_size to table_size + stash_count - 1, which is kept
+ * packed.  The ways use jen_hash with a different initval each, all derived
+ * from table->seed.
+ */
+static inline int cuckoo_pos(const table_t *table, hashkey_t K, int way)
+{
+    unsigned h = jen_hash_seed(K, table->seed + way * 0x9e3779b9u);
+    return hashes_reduce(h, table->table_size, table->size_magic);
+}
+
+/* xorshift32 for picking which resident to evict */
+static __thread unsigned cuckoo_rng = 2463534242u;
+
+static inline unsigned cuckoo_rand(void)
+{
+    cuckoo_rng ^= cuckoo_rng << 13;
+    cuckoo_rng ^= cuckoo_rng >> 17;
+    cuckoo_rng ^= cuckoo_rng << 5;
+    return cuckoo_rng;
+}
+
+/* Look in each way and then the stash.  Same inputs and outputs as
+ * table_find: *stop is the first empty way, and *del is always -1.
+ */
+static int cuckoo_find(table_t *table, hashkey_t K, int *stop, int *del)
+{
+    *stop = -1;
+    *del = -1;
+    for (int w = 0; w < CUCKOO_WAYS; w++) {
+        int index = cuckoo_pos(table, K, w);
+        hashkey_t key = slot_key(table, index);
+        if (key == K) {
+            table->num_probes = w + 1;
+            return index;
+        }
+        if (key == empty && *stop == -1) {
+            *stop = index;
+        }
+    }
+    for (int s = 0; s < table->stash_count; s++) {
+        if (slot_key(table, table->table_size + s) == K) {
+            table->num_probes = CUCKOO_WAYS + s + 1;
+            return table->table_size + s;
+        }
+    }
+    table->num_probes = CUCKOO_WAYS + table->stash_count;
+    return -1;
+}
+
+/* Place K, which is not in the table, in an empty way, evicting residents
+ * to their other ways along a random walk if all of them are full.  If the
+ * walk does not end within CUCKOO_MAX_KICKS evictions it is undone, so the
+ * table is as it was.  Each eviction counts as a probe.
+ *
+ * Outputs: 0 if K was placed, -1 if not
+ */
+static int cuckoo_kick(table_t *table, hashkey_t K, data_t I)
+{
+    int path[CUCKOO_MAX_KICKS];
+    int last = -1;
+    for (int n = 0; n < CUCKOO_MAX_KICKS; n++) {
+        int pos[CUCKOO_WAYS];
+        for (int w = 0; w < CUCKOO_WAYS; w++) {
+            pos[w] = cuckoo_pos(table, K, w);
+            if (slot_key(table, pos[w]) == empty) {
+                slot_put(table, pos[w], K, I);
+                table->num_probes += n;
+                return 0;
+            }
+        }
+        //do not send the key straight back to where it was evicted from
+        int w = cuckoo_rand() % CUCKOO_WAYS;
+        if (pos[w] == last) {
+            w = (w + 1) % CUCKOO_WAYS;
+        }
+        path[n] = last = pos[w];
+        hashkey_t evict_K = slot_key(table, last);
+        data_t evict_I = slot_data(table, last);
+        slot_put(table, last, K, I);
+        K = evict_K;
+        I = evict_I;
+    }
+    //put each evicted key back, the last one holds the original (K, I)
+    for (int n = CUCKOO_MAX_KICKS - 1; n >= 0; n--) {
+        hashkey_t back_K = slot_key(table, path[n]);
+        data_t back_I = slot_data(table, path[n]);
+        slot_put(table, path[n], K, I);
+        K = back_K;
+        I = back_I;
+    }
+    table->num_probes += CUCKOO_MAX_KICKS;
+    return -1;
+}
+
+/* Place K, which is not in the table, in its ways or in the stash.  Does
+ * not count it in num_keys.
+ * Outputs: 0 if K was placed, -1 if the stash is full
+ */
+static int cuckoo_add(table_t *table, hashkey_t K, data_t I)
+{
+    if (cuckoo_kick(table, K, I) == 0) {
+        return 0;
+    }
+    if (table->stash_count == CUCKOO_STASH) {
+        return -1;
+    }
+    slot_put(table, table->table_size + table->stash_count, K, I);
+    table->stash_count++;
+    return 0;
+}
+
+/* Pick new seeds and place every key again, along with the new key K, until
+ * all of them fit.  If no seed works within CUCKOO_MAX_RESEEDS tries, the
+ * old seed and cells are put back.
+ * Outputs: 0 if K and every key were placed, -1 if not
+ */
+static int cuckoo_reseed(table_t *table, hashkey_t K, data_t I)
+{
+    int cells = table_cells(table);
+    hashkey_t *old_keys = (hashkey_t *)malloc(cells * sizeof(hashkey_t));
+    data_t *old_data = (data_t *)malloc(cells * sizeof(data_t));
+    for (int i = 0; i < cells; i++) {
+        old_keys[i] = slot_key(table, i);
+        old_data[i] = slot_data(table, i);
+    }
+    unsigned old_seed = table->seed;
+    int old_stash = table->stash_count;
+    int probes = table->num_probes;
+
+    int placed = -1;
+    for (int tries = 0; tries < CUCKOO_MAX_RESEEDS && placed != 0; tries++) {
+        table->seed = table->seed * 1664525u + 1013904223u;
+        for (int i = 0; i < cells; i++) {
+            slot_mark(table, i, empty);
+        }
+        table->stash_count = 0;
+        placed = cuckoo_add(table, K, I);
+        for (int i = 0; i < cells && placed == 0; i++) {
+            if (old_keys[i] != empty) {
+                placed = cuckoo_add(table, old_keys[i], old_data[i]);
+            }
+        }
+    }
+    if (placed != 0) {
+        table->seed = old_seed;
+        table->stash_count = old_stash;
+        for (int i = 0; i < cells; i++) {
+            if (old_keys[i] == empty) {
+                slot_mark(table, i, empty);
+            } else {
+                slot_put(table, i, old_keys[i], old_data[i]);
+            }
+        }
+    }
+    table->num_probes = probes;
+    free(old_keys);
+    free(old_data);
+    return placed;
+}
+
+/* Insert (K, I) into a CUCKOO table.  Same return codes as table_insert. */
+static int cuckoo_insert(table_t *table, hashkey_t K, data_t I)
+{
+    int stop, del;
+    int index = cuckoo_find(table, K, &stop, &del);
+    if (index != -1) {
+        slot_release(table, index);
+        slot_put(table, index, K, I);
+        return 1; //replaced data at target
+    }
+    if ((table->table_size - table->num_keys) == 1) {
+        return -1; //not able to insert into table
+    }
+    if (stop != -1) {
+        slot_put(table, stop, K, I);
+    } else if (cuckoo_add(table, K, I) != 0 && cuckoo_reseed(table, K, I) != 0) {
+        return -1; //no seed places every key
+    }
+    table->num_keys++;
+    return 0; //new key inserted
+}
+
+/* Empty the cell at index.  A hole in the stash is filled with the last
+ * stash key, and a hole in the table with a stash key that can live there.
+ */
+static void cuckoo_remove(table_t *table, int index)
+{
+    int size = table->table_size;
+    int last = size + table->stash_count - 1;
+    if (index >= size) {
+        slot_move(table, index, last);
+        slot_mark(table, last, empty);
+        table->stash_count--;
+        return;
+    }
+    slot_mark(table, index, empty);
+    for (int s = size; s <= last; s++) {
+        hashkey_t K = slot_key(table, s);
+        for (int w = 0; w < CUCKOO_WAYS; w++) {
+            if (cuckoo_pos(table, K, w) == index) {
+                slot_put(table, index, K, slot_data(table, s));
+                cuckoo_remove(table, s);
+                return;
+            }
+        }
+    }
+}
+
+/* Hopscotch hashing for HOPSCOTCH tables.
+ *
+ * Bit i of table->hop[b] is set when slot b-i (wrapping around) holds a key
+ * whose home is b.  Every key is within HOP_RANGE slots of its home, or in
+ * the stash, cells table_size to table_size + stash_count - 1, in which
+ * case HOP_STASHED is set in the bitmap of its home.
+ */
+
+/* Compare K with the keys marked in the bitmap of its home, then with the
+ * stash if the home has keys there.  Sets num_probes to the number of keys
+ * compared, or 1 if there were none.  Same inputs and outputs as
+ * table_find, except *stop and *del are always -1.
+ */
+static ALWAYS_INLINE int hop_find_from(table_t *table, hashkey_t K, int home,
+        int *stop, int *del)
+{
+    unsigned long long bits = table->hop[home] & ~HOP_STASHED;
+    int probes = 0;
+    *stop = -1;
+    *del = -1;
+    while (bits != 0) {
+        int index = home - __builtin_ctzll(bits);
+        if (index < 0) {
+            index += table->table_size;
+        }
+        probes++;
+        if (slot_key(table, index) == K) {
+            table->num_probes = probes;
+            return index;
+        }
+        bits &= bits - 1;
+    }
+    if (table->hop[home] & HOP_STASHED) {
+        for (int s = table->table_size; s < table->table_size + table->stash_count; s++) {
+            probes++;
+            if (slot_key(table, s) == K) {
+                table->num_probes = probes;
+                return s;
+            }
+        }
+    }
+    table->num_probes = probes > 0 ? probes : 1;
+    return -1;
+}
+
+/* hop_find_from starting at the home of K */
+static ALWAYS_INLINE int hop_find_as(table_t *table, hashkey_t K, int *stop, int *del,
+        int alg)
+{
+    return hop_find_from(table, K, table_home_as(table, K, alg), stop, del);
+}
+
+/* Move K, which is not in the table, into a slot within HOP_RANGE of home.
+ *
+ * The first empty slot below home is found with a linear scan.  While it
+ * is too far from home, a key in the HOP_RANGE-1 slots above it that may
+ * live in it (its home is less than HOP_RANGE slots above it) is moved
+ * down, which moves the empty slot up.  Of those keys, the one that moves
+ * the empty slot the farthest is picked.  Does not count K in num_keys.
+ * Outputs: 0 if K was placed, -1 if no key can move and K was not placed
+ */
+static int hop_place(table_t *table, hashkey_t K, data_t I, int home)
+{
+    int size = table->table_size;
+    int hole = home;
+    int dist = 0;
+    while (slot_key(table, hole) != empty) {
+        hole--;
+        if (hole < 0) {
+            hole += size;
+        }
+        dist++;
+    }
+    int probes = table->num_probes + dist + 1;
+
+    while (dist >= HOP_RANGE) {
+        int best_up = 0, best_i = 0;
+        for (int up = HOP_RANGE - 1; up > best_up - best_i; up--) {
+            int b = hole + up;
+            if (b >= size) {
+                b -= size;
+            }
+            //keys of b stored above the hole, the nearest to b moves farthest
+            unsigned long long bits = table->hop[b] & ((1ULL << up) - 1);
+            if (bits != 0 && up - __builtin_ctzll(bits) > best_up - best_i) {
+                best_up = up;
+                best_i = __builtin_ctzll(bits);
+            }
+        }
+        if (best_up == 0) {
+            break;
+        }
+        int b = hole + best_up;
+        if (b >= size) {
+            b -= size;
+        }
+        int from = b - best_i;
+        if (from < 0) {
+            from += size;
+        }
+        slot_move(table, hole, from);
+        slot_mark(table, from, empty);
+        table->hop[b] = (table->hop[b] & ~(1ULL << best_i)) | (1ULL << best_up);
+        dist -= best_up - best_i;
+        hole = from;
+        probes++;
+    }
+    table->num_probes = probes;
+    if (dist >= HOP_RANGE) {
+        return -1;
+    }
+    slot_put(table, hole, K, I);
+    table->hop[home] |= 1ULL << dist;
+    return 0;
+}
+
+/* Place K, which is not in the table, near home or in the stash.  Does not
+ * count it in num_keys.
+ * Outputs: 0 if K was placed, -1 if the stash is full
+ */
+static int hop_add(table_t *table, hashkey_t K, data_t I, int home)
+{
+    if (hop_place(table, K, I, home) == 0) {
+        return 0;
+    }
+    if (table->stash_count == HOP_STASH) {
+        return -1;
+    }
+    slot_put(table, table->table_size + table->stash_count, K, I);
+    table->stash_count++;
+    table->hop[home] |= HOP_STASHED;
+    return 0;
+}
+
+static void hop_remove(table_t *table, int index);
+
+/* Move the stash keys that now fit near their homes back into the table.
+ * Removals only pull a stash key into a hole within its neighborhood, so
+ * holes farther away are left behind.  hop_place can bring those holes up.
+ * The stash is walked from the end, so the key hop_remove moves into a
+ * freed cell has been tried already.
+ * Outputs: number of keys left in the stash
+ */
+static int hop_reclaim(table_t *table)
+{
+    int size = table->table_size;
+    for (int s = size + table->stash_count - 1; s >= size; s--) {
+        if (hop_place(table, slot_key(table, s), slot_data(table, s),
+                    slot_home(table, s)) == 0) {
+            hop_remove(table, s);
+        }
+    }
+    return table->stash_count;
+}
+
+#define HOP_GROW 8
+
+/* Rebuild the table in place with 1/HOP_GROW more slots, and again until
+ * every key is placed.  The neighborhoods are full because of the load, so
+ * a few more empty slots are enough, and the load set by the caller changes
+ * as little as possible.  A table that is less than half full has keys that
+ * share their homes, which more slots do not fix, so the old slots are kept.
+ * Outputs: 0 if the table grew, -1 if not
+ */
+static int hop_grow(table_t *table)
+{
+    table_t old = *table;
+    int size = table->table_size;
+    int placed = -1;
+    while (placed != 0) {
+        size += size / HOP_GROW;
+        if (size > 2 * old.num_keys) {
+            *table = old;
+            return -1;
+        }
+        table_alloc_slots(table, size);
+        placed = 0;
+        for (int i = 0; i < table_cells(&old) && placed == 0; i++) {
+            if (slot_live(&old, i)) {
+                placed = hop_add(table, slot_key(&old, i), slot_data(&old, i),
+                        table_home(table, slot_key(&old, i)));
+            }
+        }
+        if (placed != 0) {
+            table_free_slots(table);
+        }
+    }
+    table_free_slots(&old);
+    return 0;
+}
+
+/* Insert (K, I) into a HOPSCOTCH table.  Same return codes as table_insert.
+ *
+ * K is moved near its home with hop_place, or goes to the stash.  If the
+ * stash is full, the stash keys that fit near their homes again are moved
+ * out of it, and if none do the table grows.
+ */
+static int hop_insert(table_t *table, hashkey_t K, data_t I)
+{
+    int stop, del;
+    int index = table->find(table, K, &stop, &del);
+    if (index != -1) {
+        slot_release(table, index);
+        slot_put(table, index, K, I);
+        return 1; //replaced data at target
+    }
+    if ((table->table_size - table->num_keys) == 1) {
+        return -1; //not able to insert into table
+    }
+    int probes = table->num_probes;
+    table->num_probes = 0;
+    while (hop_add(table, K, I, table_home(table, K)) != 0) {
+        if (hop_reclaim(table) == HOP_STASH && hop_grow(table) != 0) {
+            table->num_probes = probes;
+            return -1; //no key can make room near home
+        }
+        table->num_probes = 0;
+    }
+    table->num_probes += probes;
+    table->num_keys++;
+    return 0; //new key inserted
+}
+
+/* Empty the cell at index and clear its mark in the bitmap of its home.  A
+ * hole in the stash is filled with the last stash key, and a hole in the
+ * table with a stash key whose neighborhood covers it.
+ */
+static void hop_remove(table_t *table, int index)
+{
+    int size = table->table_size;
+    int last = size + table->stash_count - 1;
+    int home = slot_home(table, index);
+    if (index >= size) {
+        slot_move(table, index, last);
+        slot_mark(table, last, empty);
+        table->stash_count--;
+        table->hop[home] &= ~HOP_STASHED;
+        for (int s = size; s < size + table->stash_count; s++) {
+            if (slot_home(table, s) == home) {
+                table->hop[home] |= HOP_STASHED;
+                break;
+            }
+        }
+        return;
+    }
+    table->hop[home] &= ~(1ULL << probe_dist(table, index, home));
+    slot_mark(table, index, empty);
+    for (int s = size; s <= last; s++) {
+        int stash_home = slot_home(table, s);
+        int dist = probe_dist(table, index, stash_home);
+        if (dist < HOP_RANGE) {
+            slot_move(table, index, s);
+            hop_remove(table, s);
+            table->hop[stash_home] |= 1ULL << dist;
+            return;
+        }
+    }
+}
+
+/* Searches specialized for each hash algorithm and probe type.  table->find
+ * points to the one that matches the table, so insert, delete, and retrieve
+ * run a probe loop with the hash function expanded in it and no branches on
+ * the algorithm or probe type.  The ROBIN_HOOD entry is rh_find, which has
+ * the same arguments but returns the insert distance in *del.  CUCKOO
+ * tables do not use their hash algorithm and always search with
+ * cuckoo_find, so their entry is left NULL.  LINEAR, DOUBLE, and QUAD tables
+ * without TABLE_CTRL, TABLE_SOA, or TABLE_RESEED use the plain_ searches.
+ */
+typedef int (*table_find_t)(table_t *, hashkey_t, int *, int *);
+
+#define TABLE_FIND_ALG(ALG, name) \
+static int find_linear_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return table_find_as(t, K, stop, del, ALG, LINEAR); } \
+static int find_double_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return table_find_as(t, K, stop, del, ALG, DOUBLE); } \
+static int find_quad_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return table_find_as(t, K, stop, del, ALG, QUAD); } \
+static int plain_linear_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return plain_find_as(t, K, stop, del, ALG, LINEAR); } \
+static int plain_double_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return plain_find_as(t, K, stop, del, ALG, DOUBLE); } \
+static int plain_quad_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return plain_find_as(t, K, stop, del, ALG, QUAD); } \
+static int find_robin_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return rh_find_as(t, K, stop, del, ALG); } \
+static int find_hop_##name(table_t *t, hashkey_t K, int *stop, int *del) \
+{ return hop_find_as(t, K, stop, del, ALG); }
+
+TABLE_FIND_ALG(ABS_HASH, abs)
+TABLE_FIND_ALG(DJB_HASH, djb)
+TABLE_FIND_ALG(SAX_HASH, sax)
+TABLE_FIND_ALG(FNV_HASH, fnv)
+TABLE_FIND_ALG(OAT_HASH, oat)
+TABLE_FIND_ALG(JEN_HASH, jen)
+TABLE_FIND_ALG(JSW_HASH, jsw)
+TABLE_FIND_ALG(ELF_HASH, elf)
+TABLE_FIND_ALG(TAB_HASH, tab)
+TABLE_FIND_ALG(MUR_HASH, mur)
+TABLE_FIND_ALG(MXS_HASH, mxs)
+TABLE_FIND_ALG(CRC_HASH, crc)
+TABLE_FIND_ALG(TWT_HASH, twt)
+
+#define TABLE_FIND_ROW(name) \
+    {[LINEAR] = find_linear_##name, [DOUBLE] = find_double_##name, \
+     [QUAD] = find_quad_##name, [ROBIN_HOOD] = find_robin_##name, \
+     [HOPSCOTCH] = find_hop_##name}
+
+#define TABLE_PLAIN_ROW(name) \
+    {[LINEAR] = plain_linear_##name, [DOUBLE] = plain_double_##name, \
+     [QUAD] = plain_quad_##name}
+
+static const table_find_t table_find_ops[][HOPSCOTCH + 1] = {
+    [ABS_HASH] = TABLE_FIND_ROW(abs),
+    [DJB_HASH] = TABLE_FIND_ROW(djb),
+    [SAX_HASH] = TABLE_FIND_ROW(sax),
+    [FNV_HASH] = TABLE_FIND_ROW(fnv),
+    [OAT_HASH] = TABLE_FIND_ROW(oat),
+    [JEN_HASH] = TABLE_FIND_ROW(jen),
+    [JSW_HASH] = TABLE_FIND_ROW(jsw),
+    [ELF_HASH] = TABLE_FIND_ROW(elf),
+    [TAB_HASH] = TABLE_FIND_ROW(tab),
+    [MUR_HASH] = TABLE_FIND_ROW(mur),
+    [MXS_HASH] = TABLE_FIND_ROW(mxs),
+    [CRC_HASH] = TABLE_FIND_ROW(crc),
+    [TWT_HASH] = TABLE_FIND_ROW(twt),
+};
+
+static const table_find_t table_plain_ops[][QUAD + 1] = {
+    [ABS_HASH] = TABLE_PLAIN_ROW(abs),
+    [DJB_HASH] = TABLE_PLAIN_ROW(djb),
+    [SAX_HASH] = TABLE_PLAIN_ROW(sax),
+    [FNV_HASH] = TABLE_PLAIN_ROW(fnv),
+    [OAT_HASH] = TABLE_PLAIN_ROW(oat),
+    [JEN_HASH] = TABLE_PLAIN_ROW(jen),
+    [JSW_HASH] = TABLE_PLAIN_ROW(jsw),
+    [ELF_HASH] = TABLE_PLAIN_ROW(elf),
+    [TAB_HASH] = TABLE_PLAIN_ROW(tab),
+    [MUR_HASH] = TABLE_PLAIN_ROW(mur),
+    [MXS_HASH] = TABLE_PLAIN_ROW(mxs),
+    [CRC_HASH] = TABLE_PLAIN_ROW(crc),
+    [TWT_HASH] = TABLE_PLAIN_ROW(twt),
+};
+
+/* Point table->find at the search for its hash algorithm and probe type */
+static void table_bind_find(table_t *table)
+{
+    if (table->type_of_probing == CUCKOO) {
+        table->find = cuckoo_find;
+        return;
+    }
+    if (table->type_of_probing <= QUAD
+            && !(table->mode & (TABLE_CTRL | TABLE_SOA | TABLE_RESEED))) {
+        table->find = table_plain_ops[table->hash_alg][table->type_of_probing];
+        return;
+    }
+    table->find = table_find_ops[table->hash_alg][table->type_of_probing];
+}
+
+/* Index of K in this table's own slots, or -1 if it is not there */
+static int table_locate(table_t *table, hashkey_t K)
+{
+    int stop, del;
+    return table->find(table, K, &stop, &del);
+}
+
+/* Insert (K, I) into this table's own slots.  Same return codes as
+ * table_insert, but never starts or advances a resize.
+ */
+static int table_insert_slots(table_t *table, hashkey_t K, data_t I)
+{
+    if (table->type_of_probing == ROBIN_HOOD) {
+        return rh_insert(table, K, I);
+    }
+    if (table->type_of_probing == CUCKOO) {
+        return cuckoo_insert(table, K, I);
+    }
+    if (table->type_of_probing == HOPSCOTCH) {
+        return hop_insert(table, K, I);
+    }
+    int stop, del;
+    int index = table->find(table, K, &stop, &del);
+
+    if (index != -1) {
+        slot_release(table, index);
+        slot_put(table, index, K, I);
+        return 1; //replaced data at target
+    }
+    //check if table full here as could have found dupe to update in a full table above
+    if ((table->table_size - table->num_keys) == 1) {
+        return -1; //not able to insert into table
+    }
+    //reuse the first deleted cell on the probe path if there was one
+    if (del != -1) {
+        index = del;
+    } else if (stop != -1) {
+        index = stop;
+    } else {
+        return -1; //probe sequence never reaches a free cell
+    }
+    slot_put(table, index, K, I);
+    table->num_keys++;
+    return 0; //new key inserted
+}
+
+/* Insert K, which is known not to be in the table, with its full hash h.
+ * Used to move keys into new slots, where h (stored by a TABLE_HASHES table,
+ * or computed for a batch of keys with hashes_hash_batch) gives the position
+ * without hashing the key again and no search for a copy of K is needed.
+ * CUCKOO, HOPSCOTCH, and TABLE_LOCKFREE tables use table_insert_slots.
+ */
+static inline int table_places_by_hash(const table_t *table)
+{
+    return table->type_of_probing != CUCKOO && table->type_of_probing != HOPSCOTCH
+        && !(table->mode & TABLE_LOCKFREE);
+}
+
+static void table_place(table_t *table, hashkey_t K, data_t I, unsigned h)
+{
+    if (!table_places_by_hash(table)) {
+        int check_ins = table_insert_slots(table, K, I);
+        assert(check_ins == 0);
+        return;
+    }
+    assert(table->table_size - table->num_keys > 1);
+    int index, prob_dec;
+    probe_start_hash(table, h, &index, &prob_dec);
+    table->num_probes = 1;
+    if (table->type_of_probing == ROBIN_HOOD) {
+        rh_place(table, index, 0, K, I, h);
+        return;
+    }
+    //the first deleted cell is reused, as table_insert_slots would
+    while (slot_key(table, index) != empty && slot_key(table, index) != deleted) {
+        index = probe_next(table, index, &prob_dec);
+        table->num_probes++;
+        assert(table->num_probes <= table->table_size); //probe sequence never reaches a free cell
+    }
+    slot_put_hash(table, index, K, I, h);
+    table->num_keys++;
+}
+
+/* Remove the key stored at index.  The cell is marked deleted, or for
+ * ROBIN_HOOD and TABLE_BSHIFT the hole is closed by shifting the cluster.
+ * CUCKOO and HOPSCOTCH cells are emptied.
+ */
+static void table_remove_slot(table_t *table, int index)
+{
+    if (table->type_of_probing == ROBIN_HOOD) {
+        rh_remove(table, index);
+    } else if (table->type_of_probing == CUCKOO) {
+        cuckoo_remove(table, index);
+    } else if (table->type_of_probing == HOPSCOTCH) {
+        hop_remove(table, index);
+    } else if (table->mode & TABLE_BSHIFT) {
+        bshift_fill(table, index);
+    } else {
+        slot_mark(table, index, deleted);
+    }
+    table->num_keys--;
+}
+
+/* Incremental resizing for TABLE_AUTORESIZE.
+ *
+ * When an insert pushes the load above AUTO_GROW_LOAD, or a delete drops it
+ * below AUTO_SHRINK_LOAD, the current slots are handed to a second header
+ * (table->old) and the table gets new, empty slots of the new size.  Every
+ * later insert and delete moves at least AUTO_MIGRATE_STEP slots from old
+ * into the new slots, so no single call pays for the whole rebuild.  Until
+ * old is empty, searches look in the new slots first and then in old.
+ */
+#define AUTO_GROW_LOAD    0.8
+#define AUTO_SHRINK_LOAD  0.2
+#define AUTO_MIN_SIZE     16
+#define AUTO_MIGRATE_STEP 16
+
+/* return first prime number at number or greater */
+static int next_prime(int number)
+{
+    if (number <= 2) {
+        return 2;
+    }
+    if (number % 2 == 0) {
+        number++;
+    }
+    for (int i = 3; i * i <= number; i += 2) {
+        if (number % i == 0) {
+            number += 2; //only test odds
+            i = 1;
+        }
+    }
+    return number;
+}
+
+/* Move slots from table->old into the new slots, starting at the top of old
+ * so that a backward shift in old only refills slots not visited yet.
+ */
+static void auto_migrate(table_t *table, int budget)
+{
+    table_t *old = table->old;
+    int probes = table->num_probes;
+    while (budget > 0 && old->num_keys > 0 && table->migrate_pos >= 0) {
+        int i = table->migrate_pos;
+        //a ROBIN_HOOD or TABLE_BSHIFT removal can shift another key into i
+        while (slot_live(old, i)) {
+            hashkey_t K = slot_key(old, i);
+            data_t I = slot_data(old, i);
+            unsigned h = slot_hash(old, i);
+            table_remove_slot(old, i);
+            table_place(table, K, I, h);
+            budget--;
+        }
+        table->migrate_pos--;
+        budget--;
+    }
+    table->num_probes = probes;
+    if (old->num_keys == 0) {
+        table_free_slots(old);
+        free(old);
+        table->old = NULL;
+        table->migrate_pos = -1;
+    }
+}
+
+/* Start a resize if the load crossed a threshold and none is in progress */
+static void auto_check_load(table_t *table)
+{
+    int new_size;
+    if (table->old != NULL) {
+        return;
+    }
+    if (table->num_keys > AUTO_GROW_LOAD * table->table_size) {
+        new_size = 2 * table->table_size;
+    } else if (table->num_keys < AUTO_SHRINK_LOAD * table->table_size
+            && table->table_size / 2 >= AUTO_MIN_SIZE) {
+        new_size = table->table_size / 2;
+    } else {
+        return;
+    }
+    if (table->type_of_probing == DOUBLE) {
+        new_size = next_prime(new_size);
+    }
+
+    table_t *old = (table_t *)malloc(sizeof(table_t));
+    *old = *table;
+    old->mode &= ~TABLE_AUTORESIZE;
+    table_alloc_slots(table, new_size);
+    table->num_keys = 0;
+    table->max_probes = 0;
+    table->old = old;
+    table->migrate_pos = table_cells(old) - 1;
+}
+
+/* Move everything still in table->old into the new slots */
+static void auto_finish(table_t *table)
+{
+    if (table->old != NULL) {
+        auto_migrate(table, INT_MAX);
+    }
+}
+
+/* Rebuild a TABLE_RESEED table in place with a new seed.  The keys go into
+ * new slots of the same size with the normal insert, and max_probes becomes
+ * the longest of those inserts.  If a key finds no place under the new seed
+ * (a double hashing sequence that misses the free cells, or a full hopscotch
+ * neighborhood) the old slots are kept.
+ */
+static void table_reseed(table_t *table)
+{
+    int probes = table->num_probes;
+    auto_finish(table);
+    table_t old = *table;
+    table->key_seed = table_new_seed();
+    table_alloc_slots(table, table->table_size);
+    table->num_keys = 0;
+    table->max_probes = 0;
+    for (int i = 0; i < table_cells(&old); i++) {
+        if (!slot_live(&old, i)) {
+            continue;
+        }
+        if (table_insert_slots(table, slot_key(&old, i), slot_data(&old, i)) != 0) {
+            table_free_slots(table);
+            int bound = table->probe_bound;
+            *table = old;
+            table->probe_bound = 2 * bound;
+            table->num_probes = probes;
+            return;
+        }
+        if (table->num_probes > table->max_probes) {
+            table->max_probes = table->num_probes;
+        }
+    }
+    table_free_slots(&old);
+    table->reseeds++;
+    //the new seed did not help, so the sequences are long because of the load
+    while (table->max_probes > table->probe_bound) {
+        table->probe_bound *= 2;
+    }
+    table->num_probes = probes;
+}
+
+/* A TABLE_RESEED table rehashed into new_table keeps its seed, so the hashes
+ * it stored or hashed in a batch stay valid in new_table
+ */
+static inline void reseed_inherit(table_t *new_table, const table_t *T)
+{
+    new_table->key_seed = T->key_seed;
+    new_table->probe_bound = T->probe_bound;
+    new_table->reseeds = T->reseeds;
+}
+
+/* After an insert into a TABLE_RESEED table, note its probe count and
+ * reseed if it went past the bound
+ */
+static inline void reseed_check(table_t *table, int code)
+{
+    if (!(table->mode & TABLE_RESEED) || code == -1) {
+        return;
+    }
+    if (table->num_probes > table->max_probes) {
+        table->max_probes = table->num_probes;
+    }
+    if (table->max_probes > table->probe_bound) {
+        table_reseed(table);
+    }
+}
+
+/* Lock striping for TABLE_LOCKED.
+ *
+ * Slot i is guarded by lock i / LOCK_STRIPE_SLOTS.  An operation takes the
+ * lock of each stripe its probe sequence enters, in read mode for retrieve
+ * and write mode for insert and delete, and holds them all until it is done.
+ * So no other thread can change any slot the operation has looked at.
+ * Stripes are taken with trylock as the probe reaches them.  If one is busy
+ * the operation drops its stripes and starts over, so threads never wait on
+ * a lock while holding another and cannot deadlock.
+ *
+ * Every operation also holds the table lock (locks[num_locks]) in read mode.
+ * A probe sequence that enters more than LOCK_MAX_HELD stripes starts over
+ * with the table lock in write mode instead, which excludes everyone else
+ * and needs no stripes.
+ *
+ * num_keys is changed with atomic adds.  An insert reserves its key before
+ * it writes the slot, so the table never goes past table_size-1 keys.  The
+ * probe count goes to a per-thread variable instead of num_probes, as it
+ * does for TABLE_LOCKFREE.
+ */
+#define LOCK_MAX_HELD 32
+#define LOCK_OK       0
+#define LOCK_BUSY     1
+#define LOCK_TOO_MANY 2
+
+static __thread int thread_probes;
+
+typedef struct lock_set_tag {
+    int held[LOCK_MAX_HELD];    /* stripes held, most recent last */
+    int count;
+    int write;                  /* stripes are taken in write mode */
+    int exclusive;              /* table lock held in write mode */
+} lock_set_t;
+
+static void lock_begin(table_t *table, lock_set_t *set, int write)
+{
+    set->count = 0;
+    set->write = write;
+    set->exclusive = 0;
+    pthread_rwlock_rdlock(&table->locks[table->num_locks]);
+}
+
+/* Take the stripe holding index, unless it is already held */
+static int lock_take(table_t *table, lock_set_t *set, int index)
+{
+    if (set->exclusive) {
+        return LOCK_OK;
+    }
+    int stripe = index / LOCK_STRIPE_SLOTS;
+    for (int i = set->count - 1; i >= 0; i--) {
+        if (set->held[i] == stripe) {
+            return LOCK_OK;
+        }
+    }
+    if (set->count == LOCK_MAX_HELD) {
+        return LOCK_TOO_MANY;
+    }
+    pthread_rwlock_t *lock = &table->locks[stripe];
+    if ((set->write ? pthread_rwlock_trywrlock(lock) : pthread_rwlock_tryrdlock(lock)) != 0) {
+        return LOCK_BUSY;
+    }
+    set->held[set->count++] = stripe;
+    return LOCK_OK;
+}
+
+static void lock_drop_stripes(table_t *table, lock_set_t *set)
+{
+    for (int i = 0; i < set->count; i++) {
+        pthread_rwlock_unlock(&table->locks[set->held[i]]);
+    }
+    set->count = 0;
+}
+
+/* Drop everything taken so far before the operation starts over */
+static void lock_retry(table_t *table, lock_set_t *set, int status)
+{
+    lock_drop_stripes(table, set);
+    if (status == LOCK_TOO_MANY) {
+        pthread_rwlock_unlock(&table->locks[table->num_locks]);
+        pthread_rwlock_wrlock(&table->locks[table->num_locks]);
+        set->exclusive = 1;
+    } else {
+        sched_yield();
+    }
+}
+
+static void lock_end(table_t *table, lock_set_t *set)
+{
+    lock_drop_stripes(table, set);
+    pthread_rwlock_unlock(&table->locks[table->num_locks]);
+}
+
+/* Same search as table_find, taking the stripe of each slot before reading
+ * it.  *status is LOCK_OK, or the lock_take result that stopped the search.
+ */
+static int locked_find(table_t *table, hashkey_t K, lock_set_t *set,
+        int *stop, int *del, int *status)
+{
+    int index, prob_dec;
+    probe_start(table, K, &index, &prob_dec);
+    int init_index = index;
+    *stop = -1;
+    *del = -1;
+    thread_probes = 1;
+    while (1) {
+        *status = lock_take(table, set, index);
+        if (*status != LOCK_OK) {
+            return -1;
+        }
+        hashkey_t key = slot_key(table, index);
+        if (key == empty) {
+            *stop = index;
+            return -1;
+        } else if (key == K) {
+            return index;
+        } else if (key == deleted && *del == -1) {
+            *del = index;
+        }
+        index = probe_next(table, index, &prob_dec);
+        if (index == init_index) {
+            return -1;
+        }
+        thread_probes++;
+    }
+}
+
+static int locked_insert(table_t *table, hashkey_t K, data_t I)
+{
+    lock_set_t set;
+    int stop, del, status, index;
+    int code;
+    lock_begin(table, &set, 1);
+    while ((index = locked_find(table, K, &set, &stop, &del, &status)), status != LOCK_OK) {
+        lock_retry(table, &set, status);
+    }
+    if (index != -1) {
+        slot_release(table, index);
+        slot_put(table, index, K, I);
+        code = 1;
+    } else if (del == -1 && stop == -1) {
+        code = -1; //probe sequence never reaches a free cell
+    } else if (__atomic_add_fetch(&table->num_keys, 1, __ATOMIC_RELAXED) > table->table_size - 1) {
+        __atomic_sub_fetch(&table->num_keys, 1, __ATOMIC_RELAXED);
+        code = -1; //table full
+    } else {
+        slot_put(table, del != -1 ? del : stop, K, I);
+        code = 0;
+    }
+    lock_end(table, &set);
+    return code;
+}
+
+static int locked_delete(table_t *table, hashkey_t K, data_t *I)
+{
+    lock_set_t set;
+    int stop, del, status, index;
+    lock_begin(table, &set, 1);
+    while ((index = locked_find(table, K, &set, &stop, &del, &status)), status != LOCK_OK) {
+        lock_retry(table, &set, status);
+    }
+    if (index != -1) {
+        *I = slot_data(table, index);
+        slot_mark(table, index, deleted);
+        __atomic_sub_fetch(&table->num_keys, 1, __ATOMIC_RELAXED);
+    }
+    lock_end(table, &set);
+    return index != -1;
+}
+
+/* Record the probe count for table_stats */
+static inline void table_set_probes(table_t *table, int probes)
+{
+    if (table->mode & (TABLE_LOCKED | TABLE_LOCKFREE)) {
+        thread_probes = probes;
+    } else {
+        table->num_probes = probes;
+    }
+}
+
+static int locked_retrieve(table_t *table, hashkey_t K, data_t *I)
+{
+    lock_set_t set;
+    int stop, del, status, index;
+    lock_begin(table, &set, 0);
+    while ((index = locked_find(table, K, &set, &stop, &del, &status)), status != LOCK_OK) {
+        lock_retry(table, &set, status);
+    }
+    if (index != -1) {
+        *I = slot_data(table, index);
+    }
+    lock_end(table, &set);
+    return index != -1;
+}
+
+/* Lock-free operations for TABLE_LOCKFREE.
+ *
+ * A slot's key only ever changes from empty to a key, with a compare-and-swap
+ * by the insert that claims it, and stays there until table_rehash.  So a
+ * search that finds K has found the only slot K can be in.  The slot's data
+ * is the entry: NULL means K is not in the table, and insert, replace, and
+ * delete are each one compare-and-swap on the data.  A deleted key keeps its
+ * slot as a tombstone and an insert of the same key reuses it.
+ *
+ * Data taken out of the table is retired, not freed.  Each thread has a
+ * record in table->lf.  A thread inside an epoch announces the global epoch
+ * it saw, and the global epoch only advances when every announcing thread
+ * has seen the current one.  Data retired at epoch e was unreachable before
+ * the epoch moved past e, so once the global epoch reaches e+2 no thread can
+ * still be using it and it is freed.
+ */
+#define LF_RETIRE_BATCH 64
+
+static __thread int lf_thread_no;       /* 0 until the thread first needs it */
+static __thread unsigned lf_cache_serial;
+static __thread lf_thread_t *lf_cache_rec;
+static int lf_threads_seen;
+
+static inline hashkey_t *slot_key_ptr(table_t *T, int index)
+{
+    return T->keys != NULL ? &T->keys[index] : &T->oa[index].key;
+}
+
+static inline data_t *slot_data_ptr(table_t *T, int index)
+{
+    return T->data != NULL ? &T->data[index] : &T->oa[index].data_ptr;
+}
+
+/* The calling thread's record, claimed the first time it uses the table.
+ * Records are never given back, so the claimed records are always a prefix
+ * of table->lf.
+ */
+static lf_thread_t *lf_self(table_t *table)
+{
+    if (lf_cache_serial == table->lf_serial) {
+        return lf_cache_rec;
+    }
+    if (lf_thread_no == 0) {
+        lf_thread_no = __atomic_add_fetch(&lf_threads_seen, 1, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < LF_MAX_THREADS; i++) {
+        lf_thread_t *rec = &table->lf[i];
+        int owner = 0;
+        if (__atomic_compare_exchange_n(&rec->owner, &owner, lf_thread_no, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || owner == lf_thread_no) {
+            lf_cache_serial = table->lf_serial;
+            lf_cache_rec = rec;
+            return rec;
+        }
+    }
+    printf("More than %d threads used one TABLE_LOCKFREE table\n", LF_MAX_THREADS);
+    exit(1);
+}
+
+/* Move the global epoch forward if every thread in an epoch is in the
+ * current one
+ */
+static void lf_advance(table_t *table)
+{
+    unsigned long epoch = __atomic_load_n(&table->lf_epoch, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < LF_MAX_THREADS; i++) {
+        lf_thread_t *rec = &table->lf[i];
+        if (__atomic_load_n(&rec->owner, __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+        unsigned long seen = __atomic_load_n(&rec->announce, __ATOMIC_SEQ_CST);
+        if (seen != 0 && seen != epoch) {
+            return;
+        }
+    }
+    __atomic_compare_exchange_n(&table->lf_epoch, &epoch, epoch + 1, 0,
+            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/* Free the data in rec retired at least two epochs ago */
+static void lf_reclaim(table_t *table, lf_thread_t *rec)
+{
+    lf_advance(table);
+    unsigned long epoch = __atomic_load_n(&table->lf_epoch, __ATOMIC_SEQ_CST);
+    int done = 0;
+    while (done < rec->num_retired && rec->retired_epoch[done] + 2 <= epoch) {
+        free(rec->retired[done]);
+        done++;
+    }
+    rec->num_retired -= done;
+    memmove(rec->retired, rec->retired + done, rec->num_retired * sizeof(data_t));
+    memmove(rec->retired_epoch, rec->retired_epoch + done,
+            rec->num_retired * sizeof(unsigned long));
+}
+
+/* Queue I to be freed.  I must already be out of the table. */
+static void lf_retire(table_t *table, data_t I)
+{
+    lf_thread_t *rec = lf_self(table);
+    if (rec->num_retired == rec->max_retired) {
+        rec->max_retired = rec->max_retired > 0 ? 2 * rec->max_retired : LF_RETIRE_BATCH;
+        rec->retired = (data_t *)realloc(rec->retired, rec->max_retired * sizeof(data_t));
+        rec->retired_epoch = (unsigned long *)realloc(rec->retired_epoch,
+                rec->max_retired * sizeof(unsigned long));
+    }
+    rec->retired[rec->num_retired] = I;
+    rec->retired_epoch[rec->num_retired] = __atomic_load_n(&table->lf_epoch, __ATOMIC_SEQ_CST);
+    rec->num_retired++;
+    if (rec->num_retired % LF_RETIRE_BATCH == 0) {
+        lf_reclaim(table, rec);
+    }
+}
+
+/* Free everything still retired.  No other thread may be using the table. */
+static void lf_free_records(table_t *table)
+{
+    for (int i = 0; i < LF_MAX_THREADS; i++) {
+        lf_thread_t *rec = &table->lf[i];
+        for (int j = 0; j < rec->num_retired; j++) {
+            free(rec->retired[j]);
+        }
+        free(rec->retired);
+        free(rec->retired_epoch);
+    }
+    free(table->lf);
+    table->lf = NULL;
+}
+
+/* Slot holding K, or -1.  The slot may hold a tombstone. */
+static int lf_find(table_t *table, hashkey_t K)
+{
+    int index, prob_dec;
+    probe_start(table, K, &index, &prob_dec);
+    int init_index = index;
+    thread_probes = 1;
+    while (1) {
+        hashkey_t key = __atomic_load_n(slot_key_ptr(table, index), __ATOMIC_ACQUIRE);
+        if (key == K) {
+            return index;
+        } else if (key == empty) {
+            return -1;
+        }
+        index = probe_next(table, index, &prob_dec);
+        if (index == init_index) {
+            return -1;
+        }
+        thread_probes++;
+    }
+}
+
+/* Store I as the data of the slot claimed for K.  Same return codes as
+ * table_insert.
+ */
+static int lf_publish(table_t *table, int index, data_t I)
+{
+    data_t *dp = slot_data_ptr(table, index);
+    data_t old = __atomic_load_n(dp, __ATOMIC_ACQUIRE);
+    while (1) {
+        if (old != NULL) {
+            if (__atomic_compare_exchange_n(dp, &old, I, 0,
+                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                lf_retire(table, old);
+                return 1; //replaced data at target
+            }
+        } else if (__atomic_add_fetch(&table->num_keys, 1, __ATOMIC_RELAXED) > table->table_size - 1) {
+            __atomic_sub_fetch(&table->num_keys, 1, __ATOMIC_RELAXED);
+            return -1; //table full
+        } else if (__atomic_compare_exchange_n(dp, &old, I, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return 0; //new key inserted
+        } else {
+            //another insert of K got there first, replace its data instead
+            __atomic_sub_fetch(&table->num_keys, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int lf_insert(table_t *table, hashkey_t K, data_t I)
+{
+    int index, prob_dec;
+    probe_start(table, K, &index, &prob_dec);
+    int init_index = index;
+    thread_probes = 1;
+    while (1) {
+        hashkey_t *kp = slot_key_ptr(table, index);
+        hashkey_t key = __atomic_load_n(kp, __ATOMIC_ACQUIRE);
+        if (key == empty) {
+            //K is not in the table, don't claim a slot that can't be filled.
+            //Not table_full: lf_publish may have num_keys one over for a moment
+            if (I == NULL || __atomic_load_n(&table->num_keys, __ATOMIC_RELAXED)
+                    >= table->table_size - 1) {
+                return -1;
+            }
+            //on failure key is what the winner stored, which may be K
+            if (__atomic_compare_exchange_n(kp, &key, K, 0,
+                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                key = K;
+            }
+        }
+        if (key == K) {
+            return I != NULL ? lf_publish(table, index, I) : -1;
+        }
+        index = probe_next(table, index, &prob_dec);
+        if (index == init_index) {
+            return -1; //probe sequence never reaches a free cell
+        }
+        thread_probes++;
+    }
+}
+
+static data_t lf_delete(table_t *table, hashkey_t K)
+{
+    int index = lf_find(table, K);
+    if (index == -1) {
+        return NULL;
+    }
+    data_t *dp = slot_data_ptr(table, index);
+    data_t I = __atomic_load_n(dp, __ATOMIC_ACQUIRE);
+    while (I != NULL) {
+        if (__atomic_compare_exchange_n(dp, &I, NULL, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_sub_fetch(&table->num_keys, 1, __ATOMIC_RELAXED);
+            return I;
+        }
+    }
+    return NULL; //already a tombstone
+}
+
+static data_t lf_retrieve(table_t *table, hashkey_t K)
+{
+    int index = lf_find(table, K);
+    if (index == -1) {
+        return NULL;
+    }
+    return __atomic_load_n(slot_data_ptr(table, index), __ATOMIC_ACQUIRE);
+}
+
+/* Start using data retrieved from the table, see table.h
+ * Inputs: pointer to the table ADT
+ * Outputs: none
+ */
+void table_epoch_enter(table_t *table)
+{
+    if (!(table->mode & TABLE_LOCKFREE)) {
+        return;
+    }
+    lf_thread_t *rec = lf_self(table);
+    unsigned long epoch = __atomic_load_n(&table->lf_epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&rec->announce, epoch, __ATOMIC_SEQ_CST);
+    //the announce must be visible before any slot is read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* Done using data retrieved since table_epoch_enter
+ * Inputs: pointer to the table ADT
+ * Outputs: none
+ */
+void table_epoch_exit(table_t *table)
 {
-    return table->num_keys;
+    if (!(table->mode & TABLE_LOCKFREE)) {
+        return;
+    }
+    __atomic_store_n(&lf_self(table)->announce, 0, __ATOMIC_RELEASE);
 }
 
-/* This function returns 1 if the table is full and 0 if it is not full
- * Inputs: pointer to the table
- * Outputs: 0 or 1 depending on conditional
+/* Free data that was deleted from the table once no thread can be using it
+ * Inputs: pointer to the table ADT
+ *         data returned by table_delete
+ * Outputs: none
  */
-int table_full(table_t * table) 
+void table_retire(table_t *table, data_t I)
 {
-    if (table->table_size - table->num_keys >= 2) {
-        return 0;
-    } else if (table->table_size - table->num_keys == 1) {
-        return 1;
-    } else {
-        assert(false); //table is overfull
+    if (!(table->mode & TABLE_LOCKFREE)) {
+        data_release(table, I);
+        return;
+    }
+    if (I != NULL) {
+        lf_retire(table, I);
     }
 }
 
@@ -116,171 +2466,789 @@ int table_full(table_t * table)
  */
 int table_insert(table_t *table, hashkey_t K, data_t I)
 {
-    table->num_probes = 0;
+    if (table->mode & TABLE_LOCKED) {
+        return locked_insert(table, K, I);
+    }
+    if (table->mode & TABLE_LOCKFREE) {
+        return lf_insert(table, K, I);
+    }
+    if (!(table->mode & TABLE_AUTORESIZE)) {
+        int code = table_insert_slots(table, K, I);
+        reseed_check(table, code);
+        return code;
+    }
+    int old_probes = 0;
+    if (table->old != NULL) {
+        auto_migrate(table, AUTO_MIGRATE_STEP);
+    }
+    if (table->old != NULL) {
+        //K may still be waiting in old, move it over with its new data
+        int index = table_locate(table->old, K);
+        old_probes = table->old->num_probes;
+        if (index != -1) {
+            slot_release(table->old, index);
+            table_remove_slot(table->old, index);
+            int check_ins = table_insert_slots(table, K, I);
+            assert(check_ins == 0);
+            table->num_probes += old_probes;
+            return 1;
+        }
+    }
+    int code = table_insert_slots(table, K, I);
+    reseed_check(table, code);
+    table->num_probes += old_probes;
+    if (code == 0) {
+        auto_check_load(table);
+    }
+    return code;
+}
 
-    int index = hashes_table_pos(K, table->table_size);
-    int prob_dec;
+/* Remove K and set *I to its data.  Same as table_delete, but returns 1 if
+ * K was found and 0 if not, for tables where the data may be NULL.
+ */
+static int table_remove(table_t *table, hashkey_t K, data_t *I)
+{
+    if (table->mode & TABLE_LOCKED) {
+        return locked_delete(table, K, I);
+    }
+    if (table->mode & TABLE_LOCKFREE) {
+        *I = lf_delete(table, K);
+        return *I != NULL;
+    }
+    if ((table->mode & TABLE_AUTORESIZE) && table->old != NULL) {
+        auto_migrate(table, AUTO_MIGRATE_STEP);
+    }
+    table_t *holder = table;
+    int index = table_locate(table, K);
+    int probes = table->num_probes;
+    if (index == -1 && table->old != NULL) {
+        holder = table->old;
+        index = table_locate(holder, K);
+        probes += holder->num_probes;
+    }
+    table->num_probes = probes;
 
-    if (table->type_of_probing == LINEAR) {
-        prob_dec = 1;
-    } else if (table->type_of_probing == DOUBLE) {
-        prob_dec = hashes_probe_dec(K, table->table_size);
-    } else {
-        assert(table->type_of_probing == QUAD);
-        prob_dec = 0;
+    if (index == -1) {
+        //encountered an empty cell before target key
+        return 0;
+    }
+    *I = slot_data(holder, index);
+    table_remove_slot(holder, index);
+    if (table->mode & TABLE_AUTORESIZE) {
+        auto_check_load(table);
     }
+    return 1;
+}
 
-    int del_found = 0;
-    int del_index = -1; // also used as stop condition when no empty slots left in table
-    table->num_probes++; //must increment here or insert direct to empty slot will be wrong
+/* Remove the entry with key K and mark its cell as deleted, or with
+ * ROBIN_HOOD or TABLE_BSHIFT close the hole by shifting the rest of the
+ * cluster.
+ * Inputs: pointer to table ADT
+ *         target key to remove
+ * Outputs: pointer to data that was stored with K
+ *          NULL if key was not found in table
+ */
+data_t table_delete(table_t *table, hashkey_t K) 
+{
+    data_t I = NULL;
+    table_remove(table, K, &I);
+    return I;
+}
 
-    // Find slot to enter (K, I)
-    while ((table->oa[index].key != empty) && index != del_index) {
-        if (table->oa[index].key == K) {
-            free(table->oa[index].data_ptr);
-            table->oa[index].data_ptr = I;
-            return 1; //replaced data at target
-        } else if ((table->oa[index].key == deleted) && (del_found == 0)) {
-            //insert here unless find key already in table
-            del_index = index;
-            del_found++;
+/* Set *I to the data of K.  Same as table_retrieve, but returns 1 if K was
+ * found and 0 if not, for tables where the data may be NULL.
+ */
+static int table_lookup(table_t *table, hashkey_t K, data_t *I)
+{
+    if (table->mode & TABLE_LOCKED) {
+        return locked_retrieve(table, K, I);
+    }
+    if (table->mode & TABLE_LOCKFREE) {
+        *I = lf_retrieve(table, K);
+        return *I != NULL;
+    }
+    int index = table_locate(table, K);
+    if (index == -1 && table->old != NULL) {
+        //still being moved out of the old slots
+        int probes = table->num_probes;
+        index = table_locate(table->old, K);
+        table->num_probes = probes + table->old->num_probes;
+        if (index != -1) {
+            *I = slot_data(table->old, index);
+            return 1;
         }
+    }
 
-        //need to probe additional spot
-        if (table->type_of_probing == QUAD) {
-            prob_dec++;
-        }
-        index -= prob_dec;
-        while (index < 0) {
-            index += table->table_size;
-        }
-        if (index != del_index) {
-            table->num_probes++;
-        }
+    //encountered empty cell before target so key not in table
+    //or looked through entire table
+    if (index == -1) {
+        return 0;
     }
+    *I = slot_data(table, index);
+    return 1;
+}
 
-    //check if table full here as could have found dupe to update in a full table in above loop
-    if ((table->table_size - table->num_keys) == 1) {
-        return -1; //not able to insert into table
+/* Search table ADT for target key and return data at that key.
+ * Inputs: pointer to table ADT
+ *         target key to search for
+ * Outputs: pointer to data at target key
+ *          NULL if key was not found in table
+ */
+data_t table_retrieve(table_t * table, hashkey_t K) 
+{
+    data_t I = NULL;
+    table_lookup(table, K, &I);
+    return I;
+}
+
+/* A data word for a TABLE_INLINE slot holding the size bytes at value.
+ * The bytes past size are zero.
+ */
+static inline data_t value_pack(const void *value, int size)
+{
+    data_t I = NULL;
+    assert(0 <= size && size <= TABLE_VALUE_MAX);
+    memcpy(&I, value, size);
+    return I;
+}
+
+/* Insert (K, value) into a TABLE_INLINE table, see table.h
+ * Inputs: pointer to table ADT, key, value and its size in bytes
+ * Outputs: same as table_insert
+ */
+int table_insert_value(table_t *table, hashkey_t K, const void *value, int size)
+{
+    assert(table->mode & TABLE_INLINE);
+    return table_insert(table, K, value_pack(value, size));
+}
+
+/* Copy the value of K out of a TABLE_INLINE table, see table.h
+ * Inputs: pointer to table ADT, key, where to put the value and its size
+ * Outputs: 1 if K was found, 0 if not
+ */
+int table_retrieve_value(table_t *table, hashkey_t K, void *value, int size)
+{
+    data_t I;
+    assert(table->mode & TABLE_INLINE);
+    assert(0 <= size && size <= TABLE_VALUE_MAX);
+    if (!table_lookup(table, K, &I)) {
+        return 0;
     }
-    if (del_index != -1) {
-        table->oa[del_index].key = K;
-        table->oa[del_index].data_ptr = I;
-    } else {
-        table->oa[index].key = K;
-        table->oa[index].data_ptr = I;
+    memcpy(value, &I, size);
+    return 1;
+}
+
+/* Remove K from a TABLE_INLINE table and copy out its value, see table.h
+ * Inputs: pointer to table ADT, key, where to put the value (or NULL) and
+ *         its size
+ * Outputs: 1 if K was found, 0 if not
+ */
+int table_delete_value(table_t *table, hashkey_t K, void *value, int size)
+{
+    data_t I;
+    assert(table->mode & TABLE_INLINE);
+    assert(0 <= size && size <= TABLE_VALUE_MAX);
+    if (!table_remove(table, K, &I)) {
+        return 0;
     }
-    table->num_keys++;
-    return 0; //new key inserted
+    if (value != NULL) {
+        memcpy(value, &I, size);
+    }
+    return 1;
 }
 
-data_t table_delete(table_t *table, hashkey_t K) 
+/* Memory for data to be inserted into the table, see table.h
+ * Inputs: pointer to table ADT, number of bytes
+ * Outputs: pointer to the memory
+ */
+data_t table_alloc(table_t *table, int size)
 {
-    int index = hashes_table_pos(K, table->table_size);
-    int prob_dec;
-    table->num_probes = 1;
+    if (!(table->mode & TABLE_POOL)) {
+        return malloc(size);
+    }
+    assert(0 < size && size <= TABLE_POOL_MAX);
+    if (table->pool == NULL) {
+        table->pool = (pool_t *)calloc(1, sizeof(pool_t));
+    }
+    return pool_alloc(table->pool, size);
+}
+
+/* Give back data from table_alloc that is no longer in the table
+ * Inputs: pointer to table ADT, data returned by table_delete or never
+ *         inserted
+ * Outputs: none
+ */
+void table_free_data(table_t *table, data_t I)
+{
+    data_release(table, I);
+}
+
+/* How many keys ahead table_retrieve_batch prefetches.  Enough misses to
+ * keep the memory system busy, but few enough that the lines are still in
+ * the cache when the search for that key runs.
+ */
+#define BATCH_AHEAD 16
 
-    if (table->type_of_probing == LINEAR) {
-        prob_dec = 1;
-    } else if (table->type_of_probing == DOUBLE) {
-        prob_dec = hashes_probe_dec(K, table->table_size);
+/* Start loading the cache lines the search for a key with this home reads
+ * first
+ */
+static inline void table_prefetch_home(const table_t *table, int home)
+{
+    if (table->ctrl != NULL) {
+        __builtin_prefetch(table->ctrl + home);
+    }
+    if (table->hop != NULL) {
+        __builtin_prefetch(table->hop + home);
+    }
+    if (table->keys != NULL) {
+        __builtin_prefetch(table->keys + home);
+        __builtin_prefetch(table->data + home);
     } else {
-        assert(table->type_of_probing == QUAD);
-        prob_dec = 0;
+        __builtin_prefetch(table->oa + home);
     }
+}
 
-    int init_index = index; //used as stop con when table has no empty cells
-    while ((table->oa[index].key != empty)) {
-        if (table->oa[index].key == K) {
-            //found key to delete
-            table->oa[index].key = deleted;
-            table->num_keys--;
-            return table->oa[index].data_ptr;
+/* Prefetch for the n (at most BATCH_AHEAD) keys.  They are hashed together
+ * with table_hash_batch and their full hashes are left in hashes for the
+ * search, except for CUCKOO, which prefetches every way of each key and
+ * leaves hashes unset.
+ */
+static void table_prefetch_block(const table_t *table, const hashkey_t *keys, int n,
+        unsigned *hashes)
+{
+    if (table->type_of_probing == CUCKOO) {
+        for (int i = 0; i < n; i++) {
+            for (int w = 0; w < CUCKOO_WAYS; w++) {
+                int index = cuckoo_pos(table, keys[i], w);
+                if (table->keys != NULL) {
+                    __builtin_prefetch(table->keys + index);
+                } else {
+                    __builtin_prefetch(table->oa + index);
+                }
+            }
         }
-        // probe next potential spot
-        if (table->type_of_probing == QUAD) {
-            prob_dec++;
+        return;
+    }
+    table_hash_batch(table, keys, n, hashes);
+    for (int i = 0; i < n; i++) {
+        table_prefetch_home(table, hashes_reduce(hashes[i], table->table_size,
+                    table->size_magic));
+    }
+}
+
+/* Search for K, whose full hash h is known, in a LINEAR, DOUBLE, QUAD,
+ * ROBIN_HOOD, or HOPSCOTCH table.  Same as table->find, without hashing K
+ * again.
+ */
+static int table_find_hashed(table_t *table, hashkey_t K, unsigned h, int *stop, int *del)
+{
+    int plain = table->ctrl == NULL && table->keys == NULL;
+    switch (table->type_of_probing) {
+        case LINEAR:
+            return plain ? plain_find_from(table, K, h, stop, del, LINEAR)
+                : table_find_from(table, K, h, stop, del, LINEAR);
+        case DOUBLE:
+            return plain ? plain_find_from(table, K, h, stop, del, DOUBLE)
+                : table_find_from(table, K, h, stop, del, DOUBLE);
+        case QUAD:
+            return plain ? plain_find_from(table, K, h, stop, del, QUAD)
+                : table_find_from(table, K, h, stop, del, QUAD);
+        case ROBIN_HOOD:
+            return rh_find_from(table, K, hashes_reduce(h, table->table_size,
+                        table->size_magic), stop, del, table->hash_alg);
+        case HOPSCOTCH:
+            return hop_find_from(table, K, hashes_reduce(h, table->table_size,
+                        table->size_magic), stop, del);
+    }
+    assert(0);
+    return -1;
+}
+
+/* Retrieve a batch of keys.  The keys go in blocks of BATCH_AHEAD, and the
+ * next block is hashed and its home slots prefetched before the keys of
+ * the current block are searched with the hashes already computed.
+ * CUCKOO, TABLE_LOCKED, and TABLE_LOCKFREE tables, and a table in the middle
+ * of an automatic resize, search each key with table_retrieve instead.
+ *
+ * Inputs: pointer to table ADT
+ *         array of n keys to search for
+ *         array of n data pointers for the results
+ * Outputs: number of keys found, out[i] is the data for keys[i] or NULL
+ */
+int table_retrieve_batch(table_t *table, const hashkey_t *keys, int n, data_t *out)
+{
+    int found = 0;
+    int probes = 0;
+    int hashed = table->type_of_probing != CUCKOO && table->old == NULL
+        && !(table->mode & (TABLE_LOCKED | TABLE_LOCKFREE));
+    unsigned hashes[2][BATCH_AHEAD];
+    table_prefetch_block(table, keys, n < BATCH_AHEAD ? n : BATCH_AHEAD, hashes[0]);
+    for (int start = 0; start < n; start += BATCH_AHEAD) {
+        int next = start + BATCH_AHEAD;
+        unsigned *h = hashes[(start / BATCH_AHEAD) % 2];
+        if (next < n) {
+            table_prefetch_block(table, keys + next, n - next < BATCH_AHEAD ? n - next : BATCH_AHEAD,
+                    hashes[(next / BATCH_AHEAD) % 2]);
         }
-        index -= prob_dec;
-        while (index < 0) {
-            index += table->table_size;
+        for (int i = start; i < next && i < n; i++) {
+            if (hashed) {
+                int stop, del;
+                int index = table_find_hashed(table, keys[i], h[i - start], &stop, &del);
+                out[i] = index == -1 ? NULL : slot_data(table, index);
+                probes += table->num_probes;
+            } else {
+                out[i] = table_retrieve(table, keys[i]);
+                probes += table_stats(table);
+            }
+            if (out[i] != NULL) {
+                found++;
+            }
         }
-        if (index == init_index) { //checks if next index is where loop started
-            break;
+    }
+    table_set_probes(table, probes);
+    return found;
+}
+
+/* Parallel bulk load for table_build_from_array.
+ *
+ * The slots are split into one contiguous region per thread and the keys are
+ * partitioned by the region of their home slot (a radix partition on the
+ * home position).  Each thread then does linear insertion of its own keys
+ * inside its own region, so no two threads touch the same slot.  A key whose
+ * probe would step below the start of its region is set aside as a spill.
+ * The spills are inserted one at a time at the end with the normal insert,
+ * in region order, so a later copy of a key still replaces an earlier one
+ * just as sequential insertion would.
+ *
+ * The work is done in three rounds of threads: hash and count, scatter the
+ * key indices into region order, and place.  The scatter keeps input order
+ * within each region.
+ */
+#define BULK_MIN_REGION 1024
+
+typedef struct bulk_tag {
+    table_t *table;
+    const hashkey_t *keys;
+    data_t *data;
+    int n;
+    int nthreads;
+    int *home;          /* home slot of each key */
+    int *order;         /* key indices grouped by region, spills moved to front */
+    int *count;         /* [chunk * nthreads + region] counts, then offsets */
+    int *region_start;  /* nthreads+1 entries into order */
+    int *spills;        /* spills per region */
+    int *added;         /* new keys per region */
+    long *probes;       /* probes per region */
+} bulk_t;
+
+typedef struct bulk_arg_tag {
+    bulk_t *bulk;
+    int id;
+} bulk_arg_t;
+
+static inline int bulk_region(const bulk_t *b, int slot)
+{
+    return (int) ((long long) slot * b->nthreads / b->table->table_size);
+}
+
+/* first slot of region r */
+static inline int bulk_region_lo(const bulk_t *b, int r)
+{
+    return (int) (((long long) r * b->table->table_size + b->nthreads - 1) / b->nthreads);
+}
+
+static void *bulk_hash_count(void *arg)
+{
+    bulk_t *b = ((bulk_arg_t *) arg)->bulk;
+    int t = ((bulk_arg_t *) arg)->id;
+    int *count = b->count + t * b->nthreads;
+    int lo = (int) ((long long) b->n * t / b->nthreads);
+    int hi = (int) ((long long) b->n * (t + 1) / b->nthreads);
+    table_home_batch(b->table, b->keys + lo, hi - lo, b->home + lo);
+    for (int k = lo; k < hi; k++) {
+        count[bulk_region(b, b->home[k])]++;
+    }
+    return NULL;
+}
+
+static void *bulk_scatter(void *arg)
+{
+    bulk_t *b = ((bulk_arg_t *) arg)->bulk;
+    int t = ((bulk_arg_t *) arg)->id;
+    int *offset = b->count + t * b->nthreads;
+    int lo = (int) ((long long) b->n * t / b->nthreads);
+    int hi = (int) ((long long) b->n * (t + 1) / b->nthreads);
+    for (int k = lo; k < hi; k++) {
+        b->order[offset[bulk_region(b, b->home[k])]++] = k;
+    }
+    return NULL;
+}
+
+static void *bulk_place(void *arg)
+{
+    bulk_t *b = ((bulk_arg_t *) arg)->bulk;
+    int r = ((bulk_arg_t *) arg)->id;
+    table_t *table = b->table;
+    int lo = bulk_region_lo(b, r);
+    int start = b->region_start[r];
+    int spills = 0, added = 0;
+    long probes = 0;
+    for (int j = start; j < b->region_start[r + 1]; j++) {
+        int k = b->order[j];
+        hashkey_t K = b->keys[k];
+        int index = b->home[k];
+        int steps = 1;
+        while (1) {
+            hashkey_t key = slot_key(table, index);
+            if (key == empty) {
+                slot_put(table, index, K, b->data[k]);
+                added++;
+                probes += steps;
+                break;
+            } else if (key == K) {
+                slot_release(table, index);
+                slot_put(table, index, K, b->data[k]);
+                probes += steps;
+                break;
+            } else if (index == lo) {
+                b->order[start + spills++] = k; //next probe leaves the region
+                break;
+            }
+            index--;
+            steps++;
         }
-        table->num_probes++;
     }
-    //return null as encountered an empty cell before target key
+    b->spills[r] = spills;
+    b->added[r] = added;
+    b->probes[r] = probes;
     return NULL;
 }
 
-/* Search table ADT for target key and return data at that key.
- * Inputs: pointer to table ADT
- *         target key to search for
- * Outputs: pointer to data at target key
- *          NULL if key was not found in table
- */
-data_t table_retrieve(table_t * table, hashkey_t K) 
+static void bulk_run(bulk_t *b, void *(*fn)(void *))
 {
-    int index = hashes_table_pos(K, table->table_size);
-    int prob_dec;
-    table->num_probes = 1;
+    pthread_t tid[b->nthreads];
+    bulk_arg_t args[b->nthreads];
+    for (int t = 0; t < b->nthreads; t++) {
+        args[t].bulk = b;
+        args[t].id = t;
+        if (pthread_create(&tid[t], NULL, fn, &args[t]) != 0) {
+            printf("Failed to create bulk load thread\n");
+            exit(1);
+        }
+    }
+    for (int t = 0; t < b->nthreads; t++) {
+        pthread_join(tid[t], NULL);
+    }
+}
 
-    if (table->type_of_probing == LINEAR) {
-        prob_dec = 1;
-    } else if (table->type_of_probing == DOUBLE) {
-        prob_dec = hashes_probe_dec(K, table->table_size);
-    } else {
-        assert(table->type_of_probing == QUAD);
-        prob_dec = 0;
+/* Insert n keys with their data, using up to nthreads threads.  See table.h.
+ *
+ * Inputs: pointer to the table ADT
+ *         arrays of n keys and n data pointers, data is owned by the table
+ *         number of threads
+ * Outputs: 0, or -1 if a key could not be inserted
+ */
+int table_build_from_array(table_t *table, const hashkey_t *keys, data_t *data,
+        int n, int nthreads)
+{
+    long probes = 0;
+    if (table_entries(table) + n >= table->table_size) {
+        return -1; //not all keys can fit, one slot must stay empty
+    }
+    if (nthreads > table->table_size / BULK_MIN_REGION) {
+        nthreads = table->table_size / BULK_MIN_REGION;
+    }
+    if (table->type_of_probing != LINEAR
+            || (table->mode & (TABLE_AUTORESIZE | TABLE_LOCKFREE | TABLE_POOL))
+            || table->old != NULL || nthreads < 2 || table_deletekeys(table) > 0) {
+        //only the plain linear probe sequence stays inside a region, the
+        //pool's free lists are not shared by threads, and bulk_place does
+        //not reuse deleted slots
+        for (int k = 0; k < n; k++) {
+            if (table_insert(table, keys[k], data[k]) == -1) {
+                return -1;
+            }
+            probes += table_stats(table);
+        }
+        table_set_probes(table, probes);
+        return 0;
     }
 
-    int init_index = index;
-    while((table->oa[index].key != empty)) {
-        if (table->oa[index].key == K) {
-            //found the key to retrieve
-            return table->oa[index].data_ptr;
+    bulk_t b;
+    b.table = table;
+    b.keys = keys;
+    b.data = data;
+    b.n = n;
+    b.nthreads = nthreads;
+    b.home = (int *) malloc(n * sizeof(int));
+    b.order = (int *) malloc(n * sizeof(int));
+    b.count = (int *) calloc(nthreads * nthreads, sizeof(int));
+    b.region_start = (int *) malloc((nthreads + 1) * sizeof(int));
+    b.spills = (int *) malloc(nthreads * sizeof(int));
+    b.added = (int *) malloc(nthreads * sizeof(int));
+    b.probes = (long *) malloc(nthreads * sizeof(long));
+    bulk_run(&b, bulk_hash_count);
+    //turn the counts into scatter offsets: by region, then by chunk
+    int offset = 0;
+    for (int r = 0; r < nthreads; r++) {
+        b.region_start[r] = offset;
+        for (int t = 0; t < nthreads; t++) {
+            int c = b.count[t * nthreads + r];
+            b.count[t * nthreads + r] = offset;
+            offset += c;
         }
-        //probe next potential location
-        if (table->type_of_probing == QUAD) {
-            prob_dec++;
+    }
+    b.region_start[nthreads] = offset;
+    bulk_run(&b, bulk_scatter);
+    bulk_run(&b, bulk_place);
+
+    int code = 0;
+    for (int r = 0; r < nthreads; r++) {
+        table->num_keys += b.added[r];
+        probes += b.probes[r];
+    }
+    for (int r = 0; r < nthreads && code == 0; r++) {
+        for (int j = 0; j < b.spills[r]; j++) {
+            int k = b.order[b.region_start[r] + j];
+            if (table_insert_slots(table, keys[k], data[k]) == -1) {
+                code = -1;
+                break;
+            }
+            probes += table->num_probes;
         }
+    }
+    table_set_probes(table, probes);
 
-        index -= prob_dec;
-        while (index < 0) {
-            index += table->table_size;
+    free(b.home);
+    free(b.order);
+    free(b.count);
+    free(b.region_start);
+    free(b.spills);
+    free(b.added);
+    free(b.probes);
+    return code;
+}
+
+/* Rebuild the probe sequences in place, without deleted markers.
+ *
+ * Deleted cells become empty and every key is marked pending in a bitmap
+ * (one bit per slot).  Each pending key then moves to the first cell on its
+ * probe sequence that is empty or still pending, swapping with a pending key
+ * if needed.  Once placed, a key is never moved again.  Every cell on a key's
+ * probe sequence before its final cell holds a placed key, so searches still
+ * find it.
+ *
+ * Inputs: pointer to the table ADT
+ * Outputs: none, the table is rebuilt in its own arrays
+ */
+void table_compact(table_t *table)
+{
+    auto_finish(table);
+    if (table->type_of_probing == ROBIN_HOOD || table->type_of_probing == CUCKOO
+            || table->type_of_probing == HOPSCOTCH || (table->mode & TABLE_BSHIFT)) {
+        return; //never has deleted markers
+    }
+    int size = table->table_size;
+    unsigned long long *pending = (unsigned long long *)calloc((size + 63) / 64,
+            sizeof(unsigned long long));
+    int num_del = 0;
+    for (int i = 0; i < size; i++) {
+        if (slot_tombstone(table, i)) {
+            slot_mark(table, i, empty);
+            num_del++;
+        } else if (slot_key(table, i) != empty) {
+            pending[i / 64] |= 1ULL << (i % 64);
         }
-        if (index == init_index) {
-            break;
+    }
+    if (num_del == 0) {
+        free(pending);
+        return; //probe sequences are already as built
+    }
+
+    for (int i = 0; i < size; i++) {
+        while (pending[i / 64] & (1ULL << (i % 64))) {
+            hashkey_t K = slot_key(table, i);
+            data_t I = slot_data(table, i);
+            unsigned h = slot_hash(table, i);
+            int index, prob_dec;
+            probe_start_hash(table, h, &index, &prob_dec);
+            //first cell that is empty or not placed yet
+            while (index != i && slot_key(table, index) != empty
+                    && !(pending[index / 64] & (1ULL << (index % 64)))) {
+                index = probe_next(table, index, &prob_dec);
+            }
+            if (index == i) {
+                pending[i / 64] &= ~(1ULL << (i % 64));
+            } else if (slot_key(table, index) == empty) {
+                slot_put_hash(table, index, K, I, h);
+                slot_mark(table, i, empty);
+                pending[i / 64] &= ~(1ULL << (i % 64));
+            } else {
+                //swap with a pending key, which is then placed from i
+                slot_move(table, i, index);
+                slot_put_hash(table, index, K, I, h);
+                pending[index / 64] &= ~(1ULL << (index % 64));
+            }
         }
-        table->num_probes++;
     }
-    //encountered empty cell before target so key not in table
-    //or looked through entire table
-    return NULL;
+    free(pending);
 }
 
+/* keys moved by table_rehash per call of hashes_hash_batch */
+#define REHASH_BLOCK 64
+
 /* This function rehashes a table ADT. To do this, we construct a new table,
- * copy valid values between them, then free the old table
+ * copy valid values between them, then free the old table.
  * Inputs: pointer to the old table
  *         size of the new table
  * Outputs: pointer to the rehashed table
  */
 table_t *table_rehash(table_t * T, int new_table_size) 
 {
-    table_t *new_table = table_construct(new_table_size, T->type_of_probing);
+    auto_finish(T);
+    table_t *new_table = table_construct_hash(new_table_size, T->type_of_probing, T->mode,
+            T->hash_alg);
+    reseed_inherit(new_table, T);
 
-    for (int i = 0; i < T->table_size; i++) {
-        if ((T->oa[i].key == empty) || (T->oa[i].key == deleted)) {
+    //keys move in blocks, hashed together unless their hashes are stored
+    hashkey_t keys[REHASH_BLOCK];
+    data_t data[REHASH_BLOCK];
+    unsigned h[REHASH_BLOCK];
+    int m = 0;
+    for (int i = 0; i < table_cells(T) && T->num_keys > 0; i++) {
+        if (!slot_live(T, i)) {
             continue; //don't need to transfer this cell
         }
-        int check_ins = table_insert(new_table, T->oa[i].key, T->oa[i].data_ptr);
-        assert(check_ins == 0);
+        keys[m] = slot_key(T, i);
+        data[m] = slot_data(T, i);
+        if (T->hashes != NULL) {
+            h[m] = T->hashes[i];
+        }
+        m++;
         T->num_keys--;
-        if (T->num_keys == 0) { //no vaild keys remianing in old table
-            break;
+        if (m == REHASH_BLOCK || T->num_keys == 0) {
+            if (T->hashes == NULL && table_places_by_hash(new_table)) {
+                table_hash_batch(T, keys, m, h);
+            }
+            for (int j = 0; j < m; j++) {
+                table_place(new_table, keys[j], data[j], h[j]);
+            }
+            m = 0;
+        }
+    }
+    //the data lives in T's slabs, which now belong to the new table
+    new_table->pool = T->pool;
+    T->pool = NULL;
+    table_destruct(T);
+    return new_table;
+}
+
+/* Parallel rehash for table_rehash_threads.
+ *
+ * The old slots are split into one contiguous range per thread, and each
+ * thread moves the keys of its range into the new table.  A key claims the
+ * first empty cell on its probe sequence with a compare-and-swap on the key
+ * word, and moves on down the sequence if another thread claimed the cell
+ * first.  Cells are never emptied again, so every cell on the sequence
+ * before the one claimed holds a key and searches still find it.  The keys
+ * of the old table are all different, so there is no duplicate to check
+ * for.  Only the claiming thread writes a cell's data and control tag.
+ */
+#define REHASH_MIN_RANGE 1024
+
+typedef struct rehash_arg_tag {
+    table_t *old;
+    table_t *new_table;
+    int lo, hi;         /* range of old slots */
+    int moved;
+    long probes;
+} rehash_arg_t;
+
+static void *rehash_move(void *arg)
+{
+    rehash_arg_t *r = (rehash_arg_t *) arg;
+    table_t *T = r->new_table;
+    for (int i = r->lo; i < r->hi; i++) {
+        if (!slot_live(r->old, i)) {
+            continue;
+        }
+        hashkey_t K = slot_key(r->old, i);
+        unsigned h = slot_hash(r->old, i);
+        int index, prob_dec;
+        probe_start_hash(T, h, &index, &prob_dec);
+        int init_index = index;
+        r->probes++;
+        while (1) {
+            hashkey_t expect = empty;
+            if (__atomic_compare_exchange_n(slot_key_ptr(T, index), &expect, K, 0,
+                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            index = probe_next(T, index, &prob_dec);
+            assert(index != init_index); //probe sequence never reaches a free cell
+            r->probes++;
+        }
+        *slot_data_ptr(T, index) = slot_data(r->old, i);
+        if (T->ctrl != NULL) {
+            ctrl_set(T, index, ctrl_tag(K));
+        }
+        if (T->hashes != NULL) {
+            T->hashes[index] = h;
+        }
+        r->moved++;
+    }
+    return NULL;
+}
+
+/* Rehash T into a new table using nthreads threads, see table.h
+ * Inputs: pointer to the old table
+ *         size of the new table
+ *         number of threads
+ * Outputs: pointer to the rehashed table
+ */
+table_t *table_rehash_threads(table_t *T, int new_table_size, int nthreads)
+{
+    auto_finish(T);
+    if (nthreads > T->table_size / REHASH_MIN_RANGE) {
+        nthreads = T->table_size / REHASH_MIN_RANGE;
+    }
+    if (nthreads < 2 || T->type_of_probing == ROBIN_HOOD || T->type_of_probing == CUCKOO
+            || T->type_of_probing == HOPSCOTCH) {
+        //Robin Hood, cuckoo, and hopscotch placement move keys already placed
+        return table_rehash(T, new_table_size);
+    }
+    assert(T->num_keys < new_table_size);
+    table_t *new_table = table_construct_hash(new_table_size, T->type_of_probing, T->mode,
+            T->hash_alg);
+    reseed_inherit(new_table, T);
+
+    pthread_t tid[nthreads];
+    rehash_arg_t args[nthreads];
+    for (int t = 0; t < nthreads; t++) {
+        args[t].old = T;
+        args[t].new_table = new_table;
+        args[t].lo = (int) ((long long) T->table_size * t / nthreads);
+        args[t].hi = (int) ((long long) T->table_size * (t + 1) / nthreads);
+        args[t].moved = 0;
+        args[t].probes = 0;
+        if (pthread_create(&tid[t], NULL, rehash_move, &args[t]) != 0) {
+            printf("Failed to create rehash thread\n");
+            exit(1);
         }
     }
+    long probes = 0;
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(tid[t], NULL);
+        new_table->num_keys += args[t].moved;
+        probes += args[t].probes;
+    }
+    assert(new_table->num_keys == T->num_keys);
+    table_set_probes(new_table, probes);
+
+    //the data now belongs to the new table
+    T->num_keys = 0;
+    new_table->pool = T->pool;
+    T->pool = NULL;
     table_destruct(T);
     return new_table;
 }
@@ -293,13 +3261,21 @@ int table_deletekeys(table_t *table)
 {
     int num_del = 0;
     for (int i = 0; i < table->table_size; i++) {
-        if (table->oa[i].key == deleted) {
+        if (slot_tombstone(table, i)) {
             num_del++;
         }
     }
+    if (table->old != NULL) {
+        num_del += table_deletekeys(table->old);
+    }
     return num_del;
 }
 
+int table_reseeds(table_t *table)
+{
+    return table->reseeds;
+}
+
 /* This function frees all memory from the ADT
  * this includes, the data from each entry, the table itself, and the table header
  * Inputs: table pointer
@@ -307,19 +3283,33 @@ int table_deletekeys(table_t *table)
  */
 void table_destruct(table_t * table) 
 {
-    for (int i = 0 ; i < table->table_size ; i++) {
+    if (table->old != NULL) {
+        table->old->pool = NULL; //shared with table, unmapped below
+        table_destruct(table->old);
+    }
+    if (table->mode & TABLE_POOL) {
+        //all the data is in the slabs, no need to visit the slots
+        table->num_keys = 0;
+        if (table->pool != NULL) {
+            pool_destroy(table->pool);
+        }
+    }
+    for (int i = 0 ; i < table_cells(table) ; i++) {
         if (table->num_keys == 0) { //no dynamic data left to free
             break;
         }
-        if (table->oa[i].key != empty && table->oa[i].key != deleted) {
+        if (slot_live(table, i)) {
             //found table entry to clear
-            free(table->oa[i].data_ptr);
+            slot_release(table, i);
             table->num_keys--;
         }
     }
     //just ADT structures left to fill
     assert(table->num_keys == 0);
-    free(table->oa);
+    if (table->lf != NULL) {
+        lf_free_records(table);
+    }
+    table_free_slots(table);
     free(table);
 }
 
@@ -333,6 +3323,9 @@ void table_destruct(table_t * table)
  */
 int table_stats(table_t * table) 
 {
+    if (table->mode & (TABLE_LOCKED | TABLE_LOCKFREE)) {
+        return thread_probes;
+    }
     return table->num_probes;
 }
 
@@ -343,11 +3336,28 @@ int table_stats(table_t * table)
  */
 hashkey_t table_peek(table_t *table, int index) 
 {
+    if (table->old != NULL && index >= table->table_size) {
+        return table_peek(table->old, index - table->table_size);
+    }
     assert(0 <= index && index < table->table_size);
-    if (table->oa[index].key == empty || table->oa[index].key == deleted) {
+    if (!slot_live(table, index)) {
         return INT_MAX;
     }
-    return table->oa[index].key;
+    return slot_key(table, index);
+}
+
+/* This function returns the number of index positions table_peek accepts.
+ * This is the table size, plus the size of the old slots while a
+ * TABLE_AUTORESIZE table is being resized.
+ * Inputs: pointer to the table header
+ * Outputs: number of index positions
+ */
+int table_slots(table_t *table)
+{
+    if (table->old != NULL) {
+        return table->table_size + table_slots(table->old);
+    }
+    return table->table_size;
 }
 
 /* Prints the keys at each index for the provided table
@@ -360,14 +3370,22 @@ void table_debug_print(table_t *table)
     printf("\nprinting table of size %d with %d unique keys:\n", table->table_size, table->num_keys);
     printf("index\t\t\t\tkey value\n");
     for (int i = 0; i < table->table_size; i++) {
-        if (table->oa[i].key == empty) {
+        if (slot_key(table, i) == empty) {
             printf("%d\t\t\t\tempty\n", i);
-        } else if (table->oa[i].key == deleted) {
+        } else if (slot_tombstone(table, i)) {
             printf("%d\t\t\t\tdeleted\n", i);
         } else {
-            printf("%d\t\t\t\t%d\n", i, table->oa[i].key);
+            printf("%d\t\t\t\t%d\n", i, slot_key(table, i));
         }
     }
+    for (int i = table->table_size; i < table->table_size + table->stash_count; i++) {
+        printf("stash %d\t\t\t\t%d\n", i - table->table_size, slot_key(table, i));
+    }
+    if (table->old != NULL) {
+        printf("resize in progress, slots not moved yet:");
+        table_debug_print(table->old);
+        return;
+    }
     printf("print completed\n\n");
 }
 
@@ -6,12 +6,126 @@
  * 12/5/2024
  */
 
-/* constants used to indicate type of probing.  */
-enum ProbeDec_t {LINEAR, DOUBLE, QUAD};
+#include <pthread.h>
+
+/* constants used to indicate type of probing.  ROBIN_HOOD is a linear probe
+ * sequence in which an insert displaces keys that are closer to their home
+ * position than the key being inserted.
+ *
+ * CUCKOO is not a probe sequence: each key has 4 candidate slots, one from
+ * each of 4 seeded jen_hash functions, plus a stash of 4 slots after the end
+ * of the table, so a search never looks at more than 8 slots.  An insert
+ * into a key's full candidate slots evicts a resident to one of its other
+ * slots, and so on for a bounded number of steps.  When that fails the key
+ * goes to the stash, and when the stash is full the table picks new seeds
+ * and places every key again.  The table's hash algorithm is not used, and
+ * the stash is not visible to table_peek.
+ *
+ * HOPSCOTCH keeps every key within 63 slots of its home slot, below it as
+ * with LINEAR.  A bitmap per home slot marks which of those slots hold its
+ * keys, so a search only reads those keys, usually one or two cache lines
+ * next to home, at any load factor.  An insert takes the first empty slot
+ * below home, then moves it up into range by moving keys down within their
+ * own neighborhoods.  If no key can move, the key goes to a stash of 64
+ * slots after the end of the table, which is only searched for homes that
+ * have keys there.  When the stash is full, an insert first moves the stash
+ * keys that fit near their homes again back into the table, and if none do
+ * the table grows by an eighth until every key fits, so table_size can
+ * change.  An insert returns -1 only if growing would leave the table less
+ * than half full.  Deleted slots are emptied.  The stash is not visible to
+ * table_peek.
+ */
+enum ProbeDec_t {LINEAR, DOUBLE, QUAD, ROBIN_HOOD, CUCKOO, HOPSCOTCH};
+
+/* optional table modes.  Combine with | and pass to table_construct_mode.
+ *
+ *   TABLE_CTRL  keep a parallel array of 1-byte control tags (empty, deleted,
+ *               or a 7-bit fragment of the key's hash).  Probes compare the
+ *               tag first and only load the key on a match.  With LINEAR
+ *               probing 16 tags (32 with AVX2) are checked per compare.
+ *   TABLE_SOA   store keys and data pointers in two separate arrays instead
+ *               of the oa array of table_entry_t.  A probe only reads the
+ *               dense key array, so a cache line holds 16 keys instead of 4.
+ *   TABLE_BSHIFT  LINEAR only.  table_delete shifts the later members of the
+ *               cluster back into the hole instead of marking it deleted, so
+ *               the table never holds deleted markers and never needs a
+ *               rehash to clear them.
+ *   TABLE_AUTORESIZE  grow the table when the load gets high and shrink it
+ *               when the load gets low.  The keys are moved a few slots at a
+ *               time during later inserts and deletes, see table_rehash.
+ *   TABLE_LOCKED  table_insert, table_delete, table_retrieve, table_stats,
+ *               and table_entries may be called from many threads at once.
+ *               Slots are guarded by striped reader-writer locks and
+ *               table_stats reports the calling thread's last operation.
+ *               LINEAR, DOUBLE, or QUAD only, and not with TABLE_CTRL,
+ *               TABLE_BSHIFT, or TABLE_AUTORESIZE.  Everything else still
+ *               needs the table to be used by one thread at a time.  Data
+ *               replaced by table_insert is freed at once, so a thread must
+ *               not use data it retrieved while another thread may replace
+ *               or delete that key.
+ *   TABLE_LOCKFREE  like TABLE_LOCKED, but without locks.  An insert claims
+ *               an empty slot for its key with a compare-and-swap, and a key
+ *               stays in its slot until the next table_rehash, even after it
+ *               is deleted.  So a table that keeps getting new keys fills up
+ *               and has to be rehashed while no other thread uses it.  The
+ *               data pointer is swapped in and out atomically and NULL marks
+ *               a deleted key, so table_insert returns -1 for NULL data.
+ *               table_retrieve only loads and never waits.  Wrap a retrieve
+ *               and every use of the data it returned in table_epoch_enter
+ *               and table_epoch_exit, and pass data returned by
+ *               table_delete to table_retire instead of free.  LINEAR or
+ *               DOUBLE only, and not with TABLE_CTRL, TABLE_BSHIFT,
+ *               TABLE_AUTORESIZE, or TABLE_LOCKED.
+ *   TABLE_INLINE  the data word of each slot holds a value of up to
+ *               TABLE_VALUE_MAX bytes instead of a pointer to data the
+ *               table owns, so nothing is malloced per key and nothing is
+ *               freed on replace, delete, or destruct.  Use
+ *               table_insert_value, table_retrieve_value, and
+ *               table_delete_value, which copy the value in and out.  Not
+ *               with TABLE_LOCKFREE.
+ *   TABLE_POOL  the table owns the memory of its data.  Get data from
+ *               table_alloc and give data returned by table_delete back
+ *               with table_free_data instead of free.  Data is carved from
+ *               1 MB slabs, one size class per slab, and freed data goes on
+ *               the free list of its class for the next table_alloc, so a
+ *               table with churn stops calling malloc and free.
+ *               table_destruct does not walk the slots: it unmaps the slabs,
+ *               which frees every object at once.  table_rehash hands the
+ *               slabs to the new table.  Not with TABLE_LOCKED,
+ *               TABLE_LOCKFREE, or TABLE_INLINE.
+ *   TABLE_HASHES  the 32-bit hash of each key is kept in an array next to
+ *               the slots.  table_rehash, and TABLE_AUTORESIZE moves, reduce
+ *               the stored hash to the new size instead of hashing the key
+ *               again and place keys without searching for a copy.
+ *               ROBIN_HOOD searches, backward shifts, and HOPSCOTCH moves
+ *               find the home of a stored key the same way.  Costs 4 bytes
+ *               per slot, and an insert hashes K once more to store it.  Not
+ *               with CUCKOO or TABLE_LOCKFREE.
+ *   TABLE_RESEED  keys are mixed with a random per-table seed before they
+ *               are hashed, so no fixed set of keys collides in every table.
+ *               The table tracks the longest probe sequence of an insert,
+ *               and when one passes the bound (see table_set_probe_bound)
+ *               it rebuilds itself with a new seed.  If the new seed does
+ *               not bring the longest sequence under the bound, the load
+ *               and not the keys is to blame, and the bound doubles.
+ *               table_rehash keeps the seed.  Not with CUCKOO, which
+ *               reseeds on its own, TABLE_LOCKED, or TABLE_LOCKFREE.
+ */
+enum TableMode_t {TABLE_PLAIN = 0x00, TABLE_CTRL = 0x01, TABLE_SOA = 0x02,
+                  TABLE_BSHIFT = 0x04, TABLE_AUTORESIZE = 0x08,
+                  TABLE_LOCKED = 0x10, TABLE_LOCKFREE = 0x20,
+                  TABLE_INLINE = 0x40, TABLE_POOL = 0x80,
+                  TABLE_HASHES = 0x100, TABLE_RESEED = 0x200};
 
 typedef void *data_t;   /* pointer to the information, I, to be stored in the table */
 typedef int hashkey_t;   /* the key, K, for the pair (K, I) */
 
+/* largest value a TABLE_INLINE table stores in a slot */
+#define TABLE_VALUE_MAX ((int) sizeof(data_t))
+
+/* largest object table_alloc hands out for a TABLE_POOL table */
+#define TABLE_POOL_MAX 1024
+
 typedef struct table_etag {
     hashkey_t key;
     data_t data_ptr;
@@ -20,10 +134,34 @@ typedef struct table_etag {
 typedef struct table_tag {
     // you need to fill in details, and you can change the names!
     int table_size;
+    unsigned long long size_magic;  /* hashes_mod_magic(table_size) */
     int type_of_probing;
     int num_keys;
     int num_probes;
-    table_entry_t *oa;
+    int mode;               /* TableMode_t flags */
+    int hash_alg;           /* Hash_Alg_t used by this table */
+    /* search specialized for hash_alg and type_of_probing */
+    int (*find)(struct table_tag *, hashkey_t, int *, int *);
+    table_entry_t *oa;      /* NULL with TABLE_SOA */
+    hashkey_t *keys;        /* TABLE_SOA key and data arrays, NULL otherwise */
+    data_t *data;
+    unsigned char *ctrl;    /* TABLE_CTRL tags, NULL otherwise */
+    unsigned *hashes;       /* TABLE_HASHES full hash of each key, NULL otherwise */
+    struct table_tag *old;  /* TABLE_AUTORESIZE slots still being moved */
+    int migrate_pos;        /* next index of old to move */
+    pthread_rwlock_t *locks;  /* TABLE_LOCKED stripe locks, then the table lock */
+    int num_locks;          /* number of stripe locks */
+    struct lf_thread_tag *lf;   /* TABLE_LOCKFREE per-thread epoch records */
+    unsigned long lf_epoch;     /* TABLE_LOCKFREE global epoch */
+    unsigned lf_serial;         /* TABLE_LOCKFREE id, never reused */
+    unsigned seed;          /* CUCKOO hash seed, changed by each reseed */
+    int stash_count;        /* CUCKOO keys in the stash */
+    unsigned long long *hop;    /* HOPSCOTCH bitmaps, bit i of hop[b] is slot b-i */
+    struct pool_tag *pool;  /* TABLE_POOL slabs, NULL until the first table_alloc */
+    unsigned key_seed;      /* TABLE_RESEED seed mixed into each key, 0 otherwise */
+    int max_probes;         /* TABLE_RESEED longest insert probe sequence */
+    int probe_bound;        /* TABLE_RESEED max_probes that triggers a reseed */
+    int reseeds;            /* TABLE_RESEED rebuilds with a new seed so far */
 } table_t;
 
 /*  The empty table is created.  The table must be dynamically allocated and
@@ -32,7 +170,8 @@ typedef struct table_tag {
  *  the table is filled with a special empty key distinct from all other 
  *  nonempty keys.  
  *
- *  The probe_type must be one of {LINEAR, DOUBLE, QUAD}
+ *  The probe_type must be one of {LINEAR, DOUBLE, QUAD, ROBIN_HOOD, CUCKOO,
+ *  HOPSCOTCH}
  *
  *  Do not "correct" the table_size or probe decrement if there is a chance
  *  that the combinaion of table size or probe decrement will not cover
@@ -42,26 +181,87 @@ typedef struct table_tag {
  */
 table_t *table_construct(int table_size, int probe_type);  
 
+/* Same as table_construct, but also selects the optional TableMode_t
+ * features.  table_construct(size, probe) is table_construct_mode(size,
+ * probe, TABLE_PLAIN).  The mode is kept by table_rehash.
+ */
+table_t *table_construct_mode(int table_size, int probe_type, int mode);
+
+/* Same as table_construct_mode, but the table hashes with hash_alg (one of
+ * Hash_Alg_t in hashes.h) instead of the algorithm chosen with
+ * hashes_configure, so tables with different hash functions can be used
+ * side by side.  The algorithm is kept by table_rehash.
+ */
+table_t *table_construct_hash(int table_size, int probe_type, int mode, int hash_alg);
+
+/* Insert n keys and their data into T, as if table_insert were called for
+ * each pair in order: a key that appears more than once ends up with its
+ * last data, and the earlier data is freed.  For LINEAR tables with
+ * nthreads > 1 the slots are split into regions and filled by nthreads
+ * threads at once.  Other tables, TABLE_POOL tables, and tables holding
+ * deleted markers are filled one key at a time.  n plus the number of keys
+ * already in T must be less than the table size.  Returns 0, or -1 if a key
+ * could not be inserted, in which case later keys may not have been
+ * inserted either.  table_stats gives the total number of probes.
+ */
+int table_build_from_array(table_t *T, const hashkey_t *keys, data_t *data,
+        int n, int nthreads);
+
 /* Sequentially remove each table entry (K, I) and insert into a new
  * empty table with size new_table_size.  Free the memory for the old table
- * and return the pointer to the new table.  The probe type should remain
- * the same.
+ * and return the pointer to the new table.  The probe type
+ * and mode should remain the same.
  *
  * Do not rehash the table during an insert or delete function call.  Instead
  * use drivers to verify under what conditions rehashing is required, and
  * call the rehash function in the driver to show how the performance
  * can be improved.
+ *
+ * The exception is a table constructed with TABLE_AUTORESIZE.  It starts a
+ * resize on its own when an insert or delete moves the load factor past a
+ * threshold, and then moves a bounded number of slots on each later insert
+ * or delete.  Calling table_rehash on such a table first finishes any resize
+ * in progress.
  */
 table_t *table_rehash(table_t * T, int new_table_size);  
 
+/* Same as table_rehash, but the keys are moved by nthreads threads at once,
+ * each taking a share of the old slots.  The result is always a new table,
+ * also when new_table_size is the current size, and it has no deleted
+ * markers and the same number of entries.  Where each key ends up may
+ * differ from run to run.  ROBIN_HOOD tables, and tables too small to be
+ * worth splitting, are rehashed by table_rehash.  table_stats gives the
+ * total number of probes.
+ */
+table_t *table_rehash_threads(table_t *T, int new_table_size, int nthreads);
+
+/* Remove all deleted markers by rebuilding the probe sequences inside the
+ * existing table, using one bit of extra memory per slot instead of a second
+ * table.  An alternative to table_rehash at the same size when memory is
+ * tight.  Keys that find their earlier cells taken stay further from home
+ * than a fresh table_rehash would put them, so searches can take a few more
+ * probes.
+ */
+void table_compact(table_t *T);
+
 /* returns number of entries in the table */
 int table_entries(table_t *);
 
+/* returns the number of index positions accepted by table_peek.  This is
+ * the table size except while a TABLE_AUTORESIZE table is moving its keys.
+ */
+int table_slots(table_t *);
+
 /* returns 1 if table is full and 0 if not full. */
 int table_full(table_t *);
 
 /* returns the number of table entries marked as deleted */
 int table_deletekeys(table_t *);
+
+/* returns the number of times a TABLE_RESEED table rebuilt itself with a new
+ * seed, and 0 for other tables
+ */
+int table_reseeds(table_t *);
    
 /* Insert a new table entry (K, I) into the table provided the table is not
  * already full.  
@@ -81,7 +281,9 @@ int table_insert(table_t *, hashkey_t K, data_t I);
  *     null if (K, I) is not found in the table.  
  *
  * See the note on page 490 in Standish's book about marking table entries for
- * deletions when using open addressing.
+ * deletions when using open addressing.  ROBIN_HOOD and TABLE_BSHIFT tables
+ * never mark entries as deleted.  The keys after K in its cluster are shifted
+ * back instead.
  */
 data_t table_delete(table_t *, hashkey_t K); 
 
@@ -94,6 +296,56 @@ data_t table_delete(table_t *, hashkey_t K);
  */
 data_t table_retrieve(table_t *, hashkey_t K); 
 
+/* Retrieve n keys at once.  out[i] is set to what table_retrieve(T, keys[i])
+ * would return.  The home slots of later keys are prefetched while earlier
+ * keys are searched, so on large tables the cache misses overlap instead of
+ * being paid one after another.  Returns the number of keys found.
+ * table_stats gives the total number of probes for the whole batch.
+ */
+int table_retrieve_batch(table_t *T, const hashkey_t *keys, int n, data_t *out);
+
+/* Same as table_insert, table_retrieve, and table_delete for TABLE_INLINE
+ * tables.  The size bytes at value (at most TABLE_VALUE_MAX) are copied into
+ * or out of the slot of K.  table_retrieve_value and table_delete_value
+ * return 1 if K was found and 0 if not, since every value, even 0, is
+ * valid.  value may be NULL for table_delete_value.
+ */
+int table_insert_value(table_t *T, hashkey_t K, const void *value, int size);
+int table_retrieve_value(table_t *T, hashkey_t K, void *value, int size);
+int table_delete_value(table_t *T, hashkey_t K, void *value, int size);
+
+/* Longest insert probe sequence a TABLE_RESEED table allows before it
+ * rebuilds itself with a new seed.  The default is 64.
+ */
+void table_set_probe_bound(table_t *T, int bound);
+
+/* TABLE_RESEED seeds come from a sequence that starts at a value taken from
+ * the clock.  Setting the start makes the seeds, and so the tables, the same
+ * from run to run.
+ */
+void table_seed_base(unsigned long long base);
+
+/* Memory for data to be inserted into T.  For a TABLE_POOL table it comes
+ * from the table's slabs, size must be at most TABLE_POOL_MAX, and it is
+ * only valid until T is destructed.  table_free_data gives back data that
+ * table_delete returned or that was never inserted.  For other tables these
+ * are malloc and free.
+ */
+data_t table_alloc(table_t *T, int size);
+void table_free_data(table_t *T, data_t I);
+
+/* Epoch-based reclamation for TABLE_LOCKFREE.  Between table_epoch_enter
+ * and table_epoch_exit a thread may use data it retrieved from T, even if
+ * another thread deletes or replaces that key meanwhile.  table_retire frees
+ * I once no thread that might still be using it is inside an epoch.  Calls
+ * must not nest.  For other tables the epoch calls do nothing and
+ * table_retire frees I at once.  At most 64 different threads may insert,
+ * retire, or enter an epoch on one TABLE_LOCKFREE table.
+ */
+void table_epoch_enter(table_t *T);
+void table_epoch_exit(table_t *T);
+void table_retire(table_t *T, data_t I);
+
 /* Free all information in the table, the table itself, and any additional
  * headers or other supporting data structures.  
  */
@@ -66,3 +66,37 @@ echo "TEST 6 logged to myoutput"
 echo "BEGINNING TEST 7"
 ./lab6 -q >> myoutput
 echo "TEST 7 logged to myoutput"
+
+# Test 8: optional table modes (-o) must give the same results as the plain table
+#         Expected output: same probe counts as tests 2 and 3 with a table mode line added
+echo "BEGINNING TEST 8"
+./lab6 -r -t10 -v -m 40 -h linear -o ctrl >> myoutput
+./lab6 -d -o ctrl >> myoutput
+./lab6 -e -t 20 -v -m 47 -h double -o soa >> myoutput
+./lab6 -b -v -m 13 -h linear -o soa -o ctrl >> myoutput
+./lab6 -b -v -m 16 -h quad -o ctrl >> myoutput
+./lab6 -e -t 20 -v -m 47 -h robin >> myoutput
+./lab6 -r -t10 -v -m 20 -h robin -o ctrl >> myoutput
+./lab6 -e -t 20 -v -m 47 -h linear -o bshift >> myoutput
+./lab6 -e -t 2000 -m 47 -h double -o auto >> myoutput
+./lab6 -e -t 20 -v -m 48 -h quad -o ctrl -o soa -z >> myoutput
+./lab6 -r -m 65537 -h double -f jen -x fast >> myoutput
+./lab6 -r -m 65537 -f oat -l 64 -o soa >> myoutput
+./lab6 -e -m 4099 -t 20000 -l 16 -h robin >> myoutput
+./lab6 -r -m 65537 -f oat -j 4 -o ctrl >> myoutput
+./lab6 -r -m 6553 -i worst -j 2 >> myoutput
+./lab6 -c 2 -m 4099 -a 0.5 -t 20000 -h double -o soa >> myoutput
+./lab6 -c 2 -m 4099 -a 0.5 -t 20000 -h double -o lockfree >> myoutput
+./lab6 -c 2 -m 4099 -a 0.5 -t 20000 -k 2 -h double >> myoutput
+./lab6 -e -m 65537 -t 50000 -g 4 -h double -o ctrl >> myoutput
+./lab6 -r -m 65537 -h cuckoo -a 0.9 >> myoutput
+./lab6 -r -m 65537 -h hop -a 0.95 -o soa >> myoutput
+./lab6 -e -m 65537 -t 50000 -h double -o inline >> myoutput
+./lab6 -e -m 65537 -t 50000 -h linear -o pool >> myoutput
+./lab6 -e -m 65537 -t 50000 -h robin -o auto -o hashes >> myoutput
+./lab6 -r -m 65536 -i seq -h linear -f crc -x fast >> myoutput
+./lab6 -r -m 65537 -a 0.8 -f fnv -h double -l 64 >> myoutput
+./lab6 -r -m 65537 -a 0.95 -i seq -h double -f djb >> myoutput
+./lab6 -r -m 6553 -i worst -h linear -o reseed >> myoutput
+./lab6 -r -m 65537 -i seq -h linear -f twt >> myoutput
+echo "TEST 8 logged to myoutput"